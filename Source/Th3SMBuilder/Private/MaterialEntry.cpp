@@ -2,3 +2,10 @@
 
 #include "MaterialEntry.h"
 
+UMaterialInterface* UMaterialEntry::LoadMaterial()
+{
+	if (not Material) {
+		Material = MaterialPtr.LoadSynchronous();
+	}
+	return Material;
+}
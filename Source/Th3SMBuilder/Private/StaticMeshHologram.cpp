@@ -2,6 +2,8 @@
 
 #include "StaticMeshHologram.h"
 #include "Th3SMBuilder.h"
+#include "Th3BuildableSM.h"
+#include "Th3MeshResidency.h"
 
 AStaticMeshHologram::AStaticMeshHologram() : AFGBuildableHologram()
 {
@@ -14,9 +16,29 @@ AStaticMeshHologram::AStaticMeshHologram() : AFGBuildableHologram()
 
 void AStaticMeshHologram::BeginPlay()
 {
+	/* The hologram copies the CDO components, so the mesh must be there first */
+	if (ATh3BuildableSM* BuildableCDO = Cast<ATh3BuildableSM>(GetBuildClass().GetDefaultObject())) {
+		UTh3MeshResidency* MeshResidency = UTh3MeshResidency::Get(this);
+		if (MeshResidency and not BuildableCDO->GetMeshPtr().IsNull()) {
+			HeldMesh = BuildableCDO->GetMeshPtr();
+			MeshResidency->Acquire(HeldMesh);
+		}
+		BuildableCDO->EnsureMeshLoaded(this);
+	}
 	AFGBuildableHologram::BeginPlay();
 }
 
+void AStaticMeshHologram::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (not HeldMesh.IsNull()) {
+		if (UTh3MeshResidency* MeshResidency = UTh3MeshResidency::Get(this)) {
+			MeshResidency->Release(HeldMesh);
+		}
+		HeldMesh.Reset();
+	}
+	AFGBuildableHologram::EndPlay(EndPlayReason);
+}
+
 void AStaticMeshHologram::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	AFGBuildableHologram::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Th3CategoryTrie.h"
+
+/*
+ * Checks for the categories made from mesh paths, run headless with e.g.
+ *   -nullrhi -ExecCmds="Automation RunTests Th3SMBuilder.CategoryTrie; Quit"
+ */
+namespace Th3CategoryTrieTests
+{
+	static constexpr uint32 TestFlags = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter;
+
+	/* Assets both directly in folders and below them, in a few roots */
+	static const TArray<FString> Paths = {
+		TEXT("/Game/Props/SM_Direct"),
+		TEXT("/Game/Props/Big/SM_Big"),
+		TEXT("/Game/Props/Small/SM_Small"),
+		TEXT("/Game/Rocks/SM_Rock"),
+		TEXT("/SomeMod/Meshes/SM_A"),
+		TEXT("/SomeMod/Meshes/Pipes/SM_Pipe"),
+		TEXT("/OtherMod/SM_Root"),
+	};
+
+	/* Labels of all categories, or of the sub-categories of one, in menu order */
+	static FString GetLabels(const TArray<FTh3CategoryTrie::FGroup>& Groups, const int32 Parent = INDEX_NONE)
+	{
+		TArray<FString> Labels;
+		for (const FTh3CategoryTrie::FGroup& Group : Groups) {
+			if (Parent == INDEX_NONE or Group.Parent == Parent) {
+				Labels.Add(Group.Label);
+			}
+		}
+		return FString::Join(Labels, TEXT(", "));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3CategoryTrieBounds, "Th3SMBuilder.CategoryTrie.Bounds", Th3CategoryTrieTests::TestFlags)
+
+bool FTh3CategoryTrieBounds::RunTest(const FString& Parameters)
+{
+	const TArray<FString>& Paths = Th3CategoryTrieTests::Paths;
+	const TPair<int32, int32> Limits[] = { { 1, 1 }, { 2, 3 }, { 4, 2 }, { 8, 8 }, { 30, 30 } };
+	FTh3CategoryTrie Trie;
+	for (const TPair<int32, int32>& Limit : Limits) {
+		Trie.Build(Paths, Limit.Key, Limit.Value);
+		const FString Context = FString::Printf(TEXT("%d categories, %d sub-categories"), Limit.Key, Limit.Value);
+		TestTrue(FString::Printf(TEXT("At least one category with %s"), *Context), Trie.GetCategories().Num() >= 1);
+		TestTrue(FString::Printf(TEXT("Categories within the limit with %s"), *Context), Trie.GetCategories().Num() <= Limit.Key);
+
+		TArray<int32> NumSubCategories;
+		NumSubCategories.SetNumZeroed(Trie.GetCategories().Num());
+		for (const FTh3CategoryTrie::FGroup& SubCategory : Trie.GetSubCategories()) {
+			if (TestTrue(FString::Printf(TEXT("Sub-category has a category with %s"), *Context), NumSubCategories.IsValidIndex(SubCategory.Parent))) {
+				NumSubCategories[SubCategory.Parent]++;
+			}
+		}
+		for (const int32 Num : NumSubCategories) {
+			TestTrue(FString::Printf(TEXT("Every category has a sub-category with %s"), *Context), Num >= 1);
+			TestTrue(FString::Printf(TEXT("Sub-categories within the limit with %s"), *Context), Num <= Limit.Value);
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3CategoryTrieFind, "Th3SMBuilder.CategoryTrie.Find", Th3CategoryTrieTests::TestFlags)
+
+bool FTh3CategoryTrieFind::RunTest(const FString& Parameters)
+{
+	const TArray<FString>& Paths = Th3CategoryTrieTests::Paths;
+	const TPair<int32, int32> Limits[] = { { 1, 1 }, { 2, 3 }, { 3, 4 }, { 30, 30 } };
+	FTh3CategoryTrie Trie;
+	for (const TPair<int32, int32>& Limit : Limits) {
+		Trie.Build(Paths, Limit.Key, Limit.Value);
+		int32 NumValid = 0;
+		for (const FString& Path : Paths) {
+			const TPair<int32, int32> Groups = Trie.Find(Path);
+			const bool bValid = Trie.GetCategories().IsValidIndex(Groups.Key) and Trie.GetSubCategories().IsValidIndex(Groups.Value)
+				and Trie.GetSubCategories()[Groups.Value].Parent == Groups.Key;
+			NumValid += bValid ? 1 : 0;
+		}
+		TestEqual(FString::Printf(TEXT("Every path is in a sub-category of its category with %d, %d"), Limit.Key, Limit.Value), NumValid, Paths.Num());
+	}
+	const TPair<int32, int32> Unknown = Trie.Find(TEXT("/Unknown/Folder/SM_Thing"));
+	TestEqual(TEXT("Unknown folder has no category"), Unknown.Key, int32(INDEX_NONE));
+	TestEqual(TEXT("Unknown folder has no sub-category"), Unknown.Value, int32(INDEX_NONE));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3CategoryTrieShape, "Th3SMBuilder.CategoryTrie.Shape", Th3CategoryTrieTests::TestFlags)
+
+bool FTh3CategoryTrieShape::RunTest(const FString& Parameters)
+{
+	FTh3CategoryTrie Trie;
+	Trie.Build({ TEXT("/SomeMod/Deep/Chain/Meshes/SM_A"), TEXT("/SomeMod/Deep/Chain/Meshes/SM_B") }, 5, 5);
+	if (TestEqual(TEXT("Single folder chain is one category"), Trie.GetCategories().Num(), 1)) {
+		TestEqual(TEXT("Collapsed chain is labelled with the whole path"), Trie.GetCategories()[0].Label, FString(TEXT("SomeMod/Deep/Chain/Meshes")));
+	}
+	if (TestEqual(TEXT("Single folder chain is one sub-category"), Trie.GetSubCategories().Num(), 1)) {
+		TestEqual(TEXT("Sub-category of the whole category is labelled with its folder"), Trie.GetSubCategories()[0].Label, FString(TEXT("Meshes")));
+	}
+
+	const TArray<FString> Paths = {
+		TEXT("/Game/Props/SM_Direct"),
+		TEXT("/Game/Props/Big/SM_Big"),
+		TEXT("/Game/Props/Small/SM_Small"),
+		TEXT("/Game/Rocks/SM_Rock"),
+	};
+	/* Splitting Props would take its direct assets, Big, Small and Rocks, one more than allowed */
+	Trie.Build(Paths, 3, 3);
+	TestEqual(TEXT("Props stays whole"), Trie.GetCategories().Num(), 2);
+	const TPair<int32, int32> Direct = Trie.Find(Paths[0]);
+	const TPair<int32, int32> Big = Trie.Find(Paths[1]);
+	const TPair<int32, int32> Small = Trie.Find(Paths[2]);
+	const TPair<int32, int32> Rock = Trie.Find(Paths[3]);
+	TestTrue(TEXT("Whole subtree shares a category"), Direct.Key == Big.Key and Big.Key == Small.Key);
+	TestNotEqual(TEXT("Other folder gets its own category"), Rock.Key, Direct.Key);
+	TestTrue(TEXT("Direct assets and each child get their own sub-category"), Direct.Value != Big.Value and Direct.Value != Small.Value and Big.Value != Small.Value);
+	if (Trie.GetSubCategories().IsValidIndex(Direct.Value)) {
+		TestEqual(TEXT("Direct assets are labelled with their folder"), Trie.GetSubCategories()[Direct.Value].Label, FString(TEXT("Props")));
+	}
+	if (Trie.GetSubCategories().IsValidIndex(Big.Value)) {
+		TestEqual(TEXT("Child sub-category is labelled relative to its category"), Trie.GetSubCategories()[Big.Value].Label, FString(TEXT("Big")));
+	}
+
+	/* Now there is room to split Props in the top level */
+	Trie.Build(Paths, 4, 3);
+	TestEqual(TEXT("Props is split"), Trie.GetCategories().Num(), 4);
+	const TPair<int32, int32> SplitDirect = Trie.Find(Paths[0]);
+	const TPair<int32, int32> SplitBig = Trie.Find(Paths[1]);
+	TestNotEqual(TEXT("Direct assets only category"), SplitDirect.Key, SplitBig.Key);
+	if (Trie.GetCategories().IsValidIndex(SplitDirect.Key) and Trie.GetCategories().IsValidIndex(SplitBig.Key)) {
+		TestEqual(TEXT("Direct assets only category is labelled with its folder"), Trie.GetCategories()[SplitDirect.Key].Label, FString(TEXT("Game/Props")));
+		TestEqual(TEXT("Whole subtree category"), Trie.GetCategories()[SplitBig.Key].Label, FString(TEXT("Game/Props/Big")));
+	}
+	TestEqual(TEXT("Menu order follows the paths"), Trie.GetCategories()[0].Label, FString(TEXT("Game/Props")));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3CategoryTrieRanges, "Th3SMBuilder.CategoryTrie.Ranges", Th3CategoryTrieTests::TestFlags)
+
+bool FTh3CategoryTrieRanges::RunTest(const FString& Parameters)
+{
+	using Th3CategoryTrieTests::GetLabels;
+	FTh3CategoryTrie Trie;
+
+	/* Three roots with room for two, so the last two roots share a range */
+	Trie.Build(Th3CategoryTrieTests::Paths, 2, 3);
+	TestEqual(TEXT("Roots are split into ranges"), GetLabels(Trie.GetCategories()), FString(TEXT("Game, OtherMod - SomeMod")));
+	TestEqual(TEXT("Whole root is split into its folders"), GetLabels(Trie.GetSubCategories(), 0), FString(TEXT("Props, Rocks")));
+	TestEqual(TEXT("Range is split into its roots"), GetLabels(Trie.GetSubCategories(), 1), FString(TEXT("OtherMod, SomeMod/Meshes, SomeMod/Meshes/Pipes")));
+	TestEqual(TEXT("Range has the assets of its first root"), Trie.Find(TEXT("/OtherMod/SM_Root")).Key, 1);
+	TestEqual(TEXT("Range has the assets of its last root"), Trie.Find(TEXT("/SomeMod/Meshes/Pipes/SM_Pipe")).Key, 1);
+
+	/* No room to split anything */
+	Trie.Build(Th3CategoryTrieTests::Paths, 1, 1);
+	TestEqual(TEXT("Everything in one labelled category"), GetLabels(Trie.GetCategories()), FString(TEXT("All")));
+	TestEqual(TEXT("Everything in one labelled sub-category"), GetLabels(Trie.GetSubCategories()), FString(TEXT("All")));
+
+	/* More roots than categories, as with many mods installed */
+	TArray<FString> ModPaths;
+	for (int32 Idx = 0; Idx < 30; Idx++) {
+		ModPaths.Add(FString::Printf(TEXT("/Mod%02d/Meshes/SM_Thing"), Idx));
+	}
+	Trie.Build(ModPaths, 24, 4);
+	const TArray<FTh3CategoryTrie::FGroup>& Categories = Trie.GetCategories();
+	TestEqual(TEXT("Roots use every category"), Categories.Num(), 24);
+	TestFalse(TEXT("Every category has a label"), Categories.ContainsByPredicate([](const FTh3CategoryTrie::FGroup& Category) { return Category.Label.IsEmpty(); }));
+	if (Categories.Num() == 24) {
+		TestEqual(TEXT("Root of its own collapses"), Categories[0].Label, FString(TEXT("Mod00/Meshes")));
+		TestEqual(TEXT("Range is labelled with its first and last root"), Categories[3].Label, FString(TEXT("Mod03 - Mod04")));
+	}
+	const TPair<int32, int32> First = Trie.Find(ModPaths[3]);
+	const TPair<int32, int32> Last = Trie.Find(ModPaths[4]);
+	TestEqual(TEXT("Roots in a range share a category"), First.Key, Last.Key);
+	TestNotEqual(TEXT("Roots in a range get their own sub-category"), First.Value, Last.Value);
+	TestEqual(TEXT("Range sub-categories"), GetLabels(Trie.GetSubCategories(), First.Key), FString(TEXT("Mod03/Meshes, Mod04/Meshes")));
+	return true;
+}
+
+#endif
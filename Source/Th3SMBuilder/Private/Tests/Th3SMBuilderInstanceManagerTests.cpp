@@ -0,0 +1,189 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Th3InstanceManager.h"
+
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Materials/Material.h"
+
+/*
+ * Checks for instanced rendering of placed buildables, run with e.g.
+ *   -nullrhi -ExecCmds="Automation RunTests Th3SMBuilder.InstanceManager; Quit"
+ * Plain actors stand in for buildables, the manager only uses them as keys.
+ */
+namespace Th3InstanceManagerTests
+{
+	static constexpr uint32 TestFlags = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter;
+
+	/* A game world of its own, torn down again when the test is done */
+	struct FTestWorld
+	{
+		UWorld* World;
+
+		FTestWorld()
+		{
+			World = UWorld::CreateWorld(EWorldType::Game, false);
+			FWorldContext& Context = GEngine->CreateNewWorldContext(EWorldType::Game);
+			Context.SetCurrentWorld(World);
+			World->InitializeActorsForPlay(FURL());
+			World->BeginPlay();
+		}
+
+		~FTestWorld()
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+		}
+
+		TArray<AActor*> SpawnOwners(const int32 Count) const
+		{
+			TArray<AActor*> Owners;
+			for (int32 Idx = 0; Idx < Count; Idx++) {
+				Owners.Add(World->SpawnActor<AActor>());
+			}
+			return Owners;
+		}
+	};
+
+	static FTransform MakeTransform(const int32 Idx)
+	{
+		return FTransform(FVector(100.0 * Idx, 0.0, 0.0));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3InstanceManagerAddRemove, "Th3SMBuilder.InstanceManager.AddRemove", Th3InstanceManagerTests::TestFlags)
+
+bool FTh3InstanceManagerAddRemove::RunTest(const FString& Parameters)
+{
+	Th3InstanceManagerTests::FTestWorld TestWorld;
+	UTh3InstanceManager* Manager = UTh3InstanceManager::Get(TestWorld.World);
+	UStaticMesh* Mesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (not TestNotNull(TEXT("Instance manager"), Manager) or not TestNotNull(TEXT("Mesh"), Mesh)) {
+		return false;
+	}
+	const TArray<UMaterialInterface*> Materials = { UMaterial::GetDefaultMaterial(MD_Surface) };
+	const TArray<AActor*> Owners = TestWorld.SpawnOwners(3);
+
+	TestFalse(TEXT("Nothing to add without a mesh"), Manager->AddInstance(Owners[0], nullptr, Materials, FTransform::Identity));
+	TestFalse(TEXT("Nothing to remove"), Manager->RemoveInstance(Owners[0]));
+	for (int32 Idx = 0; Idx < Owners.Num(); Idx++) {
+		TestTrue(TEXT("Add instance"), Manager->AddInstance(Owners[Idx], Mesh, Materials, Th3InstanceManagerTests::MakeTransform(Idx)));
+	}
+	TestEqual(TEXT("Same mesh and materials share a group"), Manager->GetNumGroups(), 1);
+	TestEqual(TEXT("One instance per owner"), Manager->GetNumInstances(), 3);
+
+	UHierarchicalInstancedStaticMeshComponent* Component = nullptr;
+	int32 Instance = INDEX_NONE;
+	TestTrue(TEXT("Owner is drawn as an instance"), Manager->FindInstance(Owners[2], Component, Instance));
+	TestEqual(TEXT("Instances are added at the end"), Instance, 2);
+	if (not TestNotNull(TEXT("Group component"), Component)) {
+		return false;
+	}
+	TestEqual(TEXT("Component holds every instance"), Component->GetInstanceCount(), 3);
+
+	TestTrue(TEXT("Adding again replaces the instance"), Manager->AddInstance(Owners[1], Mesh, Materials, Th3InstanceManagerTests::MakeTransform(1)));
+	TestEqual(TEXT("Replaced instance is not doubled"), Manager->GetNumInstances(), 3);
+	TestEqual(TEXT("Replaced instance is not doubled in the component"), Component->GetInstanceCount(), 3);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3InstanceManagerRemoveAtSwap, "Th3SMBuilder.InstanceManager.RemoveAtSwap", Th3InstanceManagerTests::TestFlags)
+
+bool FTh3InstanceManagerRemoveAtSwap::RunTest(const FString& Parameters)
+{
+	Th3InstanceManagerTests::FTestWorld TestWorld;
+	UTh3InstanceManager* Manager = UTh3InstanceManager::Get(TestWorld.World);
+	UStaticMesh* Mesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (not TestNotNull(TEXT("Instance manager"), Manager) or not TestNotNull(TEXT("Mesh"), Mesh)) {
+		return false;
+	}
+	const TArray<UMaterialInterface*> Materials = { UMaterial::GetDefaultMaterial(MD_Surface) };
+	const TArray<AActor*> Owners = TestWorld.SpawnOwners(4);
+	for (int32 Idx = 0; Idx < Owners.Num(); Idx++) {
+		Manager->AddInstance(Owners[Idx], Mesh, Materials, Th3InstanceManagerTests::MakeTransform(Idx));
+	}
+
+	/* The last instance moves into the hole, its owner has to follow it */
+	TestTrue(TEXT("Remove first instance"), Manager->RemoveInstance(Owners[0]));
+	UHierarchicalInstancedStaticMeshComponent* Component = nullptr;
+	int32 Instance = INDEX_NONE;
+	TestFalse(TEXT("Removed owner is not drawn"), Manager->FindInstance(Owners[0], Component, Instance));
+	TestTrue(TEXT("Last owner is still drawn"), Manager->FindInstance(Owners[3], Component, Instance));
+	TestEqual(TEXT("Last owner moved into the hole"), Instance, 0);
+	if (not TestNotNull(TEXT("Group component"), Component)) {
+		return false;
+	}
+	TestEqual(TEXT("Component lost one instance"), Component->GetInstanceCount(), 3);
+
+	/* Every owner has to point at the instance with its own transform */
+	for (int32 Idx = 1; Idx < Owners.Num(); Idx++) {
+		FTransform Transform;
+		if (Manager->FindInstance(Owners[Idx], Component, Instance) and Component->GetInstanceTransform(Instance, Transform, true)) {
+			TestEqual(FString::Printf(TEXT("Instance of owner %d"), Idx), Transform.GetLocation(), Th3InstanceManagerTests::MakeTransform(Idx).GetLocation());
+		} else {
+			AddError(FString::Printf(TEXT("Owner %d lost its instance"), Idx));
+		}
+	}
+
+	/* Removing the moved owner only works if its handle was fixed up */
+	TestTrue(TEXT("Remove moved instance"), Manager->RemoveInstance(Owners[3]));
+	TestEqual(TEXT("Component lost another instance"), Component->GetInstanceCount(), 2);
+	TestEqual(TEXT("Instances left"), Manager->GetNumInstances(), 2);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3InstanceManagerGroups, "Th3SMBuilder.InstanceManager.Groups", Th3InstanceManagerTests::TestFlags)
+
+bool FTh3InstanceManagerGroups::RunTest(const FString& Parameters)
+{
+	Th3InstanceManagerTests::FTestWorld TestWorld;
+	UTh3InstanceManager* Manager = UTh3InstanceManager::Get(TestWorld.World);
+	UStaticMesh* Mesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	UMaterialInterface* OtherMaterial = LoadObject<UMaterialInterface>(nullptr, TEXT("/Engine/BasicShapes/BasicShapeMaterial.BasicShapeMaterial"));
+	if (not TestNotNull(TEXT("Instance manager"), Manager) or not TestNotNull(TEXT("Mesh"), Mesh) or not TestNotNull(TEXT("Material"), OtherMaterial)) {
+		return false;
+	}
+	UMaterialInterface* DefaultMaterial = UMaterial::GetDefaultMaterial(MD_Surface);
+	const TArray<AActor*> Owners = TestWorld.SpawnOwners(4);
+	Manager->AddInstance(Owners[0], Mesh, { DefaultMaterial }, FTransform::Identity);
+	Manager->AddInstance(Owners[1], Mesh, { OtherMaterial }, FTransform::Identity);
+	Manager->AddInstance(Owners[2], Mesh, { DefaultMaterial, OtherMaterial }, FTransform::Identity);
+	Manager->AddInstance(Owners[3], Mesh, { OtherMaterial }, FTransform::Identity);
+	TestEqual(TEXT("One group per material set"), Manager->GetNumGroups(), 3);
+
+	UHierarchicalInstancedStaticMeshComponent* First = nullptr;
+	UHierarchicalInstancedStaticMeshComponent* Second = nullptr;
+	int32 Instance = INDEX_NONE;
+	Manager->FindInstance(Owners[1], First, Instance);
+	Manager->FindInstance(Owners[3], Second, Instance);
+	TestTrue(TEXT("Same material set shares a component"), First and First == Second);
+	if (First) {
+		TestEqual(TEXT("Component uses the material set"), First->GetMaterial(0), OtherMaterial);
+	}
+
+	/* Empty groups give their component back */
+	Manager->RemoveInstance(Owners[1]);
+	TestEqual(TEXT("Group with instances left stays"), Manager->GetNumGroups(), 3);
+	TestTrue(TEXT("Component with instances left stays"), IsValid(First));
+	Manager->RemoveInstance(Owners[3]);
+	TestEqual(TEXT("Empty group is removed"), Manager->GetNumGroups(), 2);
+	TestFalse(TEXT("Component of the empty group is destroyed"), IsValid(First));
+
+	/* The group can come back after it was removed */
+	Manager->AddInstance(Owners[1], Mesh, { OtherMaterial }, FTransform::Identity);
+	TestEqual(TEXT("Group is made again"), Manager->GetNumGroups(), 3);
+	for (AActor* Owner : Owners) {
+		Manager->RemoveInstance(Owner);
+	}
+	TestEqual(TEXT("No groups left"), Manager->GetNumGroups(), 0);
+	TestEqual(TEXT("No instances left"), Manager->GetNumInstances(), 0);
+	return true;
+}
+
+#endif
@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Th3TokenTrie.h"
+
+/*
+ * Checks for the mesh search index, run headless with e.g.
+ *   -nullrhi -ExecCmds="Automation RunTests Th3SMBuilder.MeshSearch; Quit"
+ */
+namespace Th3MeshSearchTests
+{
+	static constexpr uint32 TestFlags = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter;
+
+	/* Every document is indexed by all of its paths, like a mesh and its aliases */
+	static void BuildTrie(FTh3TokenTrie& Trie, TConstArrayView<TArray<FString>> Docs)
+	{
+		Trie.Reset();
+		TArray<FString> Tokens;
+		for (int32 DocId = 0; DocId < Docs.Num(); DocId++) {
+			Tokens.Reset();
+			for (const FString& Path : Docs[DocId]) {
+				FTh3TokenTrie::Tokenize(Path, Tokens);
+			}
+			for (const FString& Token : Tokens) {
+				Trie.Add(DocId, Token);
+			}
+		}
+		Trie.Build();
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3MeshSearchTokenize, "Th3SMBuilder.MeshSearch.Tokenize", Th3MeshSearchTests::TestFlags)
+
+bool FTh3MeshSearchTokenize::RunTest(const FString& Parameters)
+{
+	TArray<FString> Tokens;
+	FTh3TokenTrie::Tokenize(TEXT("/Game/Props/SM_RockLarge02.SM_RockLarge02"), Tokens);
+	const TArray<FString> Expected = {
+		TEXT("Game"), TEXT("Props"),
+		TEXT("SM_RockLarge02"), TEXT("SM"), TEXT("Rock"), TEXT("Large"), TEXT("02"),
+		TEXT("SM_RockLarge02"), TEXT("SM"), TEXT("Rock"), TEXT("Large"), TEXT("02"),
+	};
+	TestEqual(TEXT("Segments, then the words in them"), Tokens, Expected);
+
+	Tokens.Reset();
+	FTh3TokenTrie::Tokenize(TEXT("//Game//Rocks/"), Tokens);
+	TestEqual(TEXT("Empty segments are skipped and single words are not repeated"), Tokens, TArray<FString>{ TEXT("Game"), TEXT("Rocks") });
+
+	Tokens.Reset();
+	FTh3TokenTrie::Tokenize(TEXT("/Mod/Pipe-Straight_2m"), Tokens);
+	const TArray<FString> ExpectedWords = { TEXT("Mod"), TEXT("Pipe-Straight_2m"), TEXT("Pipe"), TEXT("Straight"), TEXT("2"), TEXT("m") };
+	TestEqual(TEXT("Words split at any separator and between digits and letters"), Tokens, ExpectedWords);
+
+	Tokens.Reset();
+	FTh3TokenTrie::Tokenize(TEXT(""), Tokens);
+	TestTrue(TEXT("Nothing to tokenize"), Tokens.IsEmpty());
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3MeshSearchQuery, "Th3SMBuilder.MeshSearch.Query", Th3MeshSearchTests::TestFlags)
+
+bool FTh3MeshSearchQuery::RunTest(const FString& Parameters)
+{
+	const TArray<TArray<FString>> Docs = {
+		{ TEXT("/Game/Rocks/SM_RockLarge.SM_RockLarge") },
+		{ TEXT("/Game/Props/SM_Crate.SM_Crate"), TEXT("/SomeMod/Props/SM_Box.SM_Box") },
+		{ TEXT("/SomeMod/Rocks/SM_Pebble.SM_Pebble") },
+		{ TEXT("/Game/Props/SM_Pipe.SM_Pipe") },
+	};
+	FTh3TokenTrie Trie;
+	Th3MeshSearchTests::BuildTrie(Trie, Docs);
+
+	TBitArray<> Found;
+	Found.Init(false, Docs.Num());
+	Trie.FindPrefix(TEXT("roc"), Found);
+	TestEqual(TEXT("Prefix of a folder and of a word"), Found.CountSetBits(), 2);
+	TestTrue(TEXT("Word in the mesh name"), Found[0]);
+	TestTrue(TEXT("Folder name"), Found[2]);
+
+	TArray<int32> DocIds;
+	TestEqual(TEXT("Queries ignore case"), Trie.Search(TEXT("ROCK"), Docs.Num(), 0, 10, DocIds), 2);
+	TestEqual(TEXT("Every word has to match"), Trie.Search(TEXT("rock  somemod"), Docs.Num(), 0, 10, DocIds), 1);
+	TestEqual(TEXT("Every word has to match the same document"), DocIds, TArray<int32>{ 2 });
+	TestEqual(TEXT("Words match anywhere in the path"), Trie.Search(TEXT("props pipe"), Docs.Num(), 0, 10, DocIds), 1);
+	TestEqual(TEXT("Unknown word"), Trie.Search(TEXT("rock glass"), Docs.Num(), 0, 10, DocIds), 0);
+	TestTrue(TEXT("Unknown word gives an empty page"), DocIds.IsEmpty());
+
+	TestEqual(TEXT("Alias path"), Trie.Search(TEXT("box"), Docs.Num(), 0, 10, DocIds), 1);
+	TestEqual(TEXT("Alias path finds the document it belongs to"), DocIds, TArray<int32>{ 1 });
+	TestEqual(TEXT("Words from the mesh and its alias"), Trie.Search(TEXT("crate somemod"), Docs.Num(), 0, 10, DocIds), 1);
+	TestEqual(TEXT("Tokens in several paths count a document once"), Trie.Search(TEXT("sm_"), Docs.Num(), 0, 10, DocIds), Docs.Num());
+
+	TestEqual(TEXT("Empty query matches everything"), Trie.Search(TEXT(" "), Docs.Num(), 0, 10, DocIds), Docs.Num());
+	TestEqual(TEXT("Empty query gives documents in order"), DocIds, TArray<int32>{ 0, 1, 2, 3 });
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3MeshSearchPaging, "Th3SMBuilder.MeshSearch.Paging", Th3MeshSearchTests::TestFlags)
+
+bool FTh3MeshSearchPaging::RunTest(const FString& Parameters)
+{
+	TArray<TArray<FString>> Docs;
+	for (int32 Idx = 0; Idx < 7; Idx++) {
+		/* Every other document has a rock, so pages skip over the others */
+		Docs.Add({ FString::Printf(TEXT("/Game/%s/SM_Thing%d.SM_Thing%d"), Idx % 2 == 0 ? TEXT("Rocks") : TEXT("Props"), Idx, Idx) });
+	}
+	FTh3TokenTrie Trie;
+	Th3MeshSearchTests::BuildTrie(Trie, Docs);
+
+	TArray<int32> DocIds;
+	TestEqual(TEXT("Total over all pages"), Trie.Search(TEXT("rocks"), Docs.Num(), 0, 3, DocIds), 4);
+	TestEqual(TEXT("First page"), DocIds, TArray<int32>{ 0, 2, 4 });
+	TestEqual(TEXT("Total does not depend on the page"), Trie.Search(TEXT("rocks"), Docs.Num(), 1, 3, DocIds), 4);
+	TestEqual(TEXT("Last page is partial"), DocIds, TArray<int32>{ 6 });
+	Trie.Search(TEXT("rocks"), Docs.Num(), 2, 3, DocIds);
+	TestTrue(TEXT("Page past the end is empty"), DocIds.IsEmpty());
+
+	Trie.Search(TEXT("rocks"), Docs.Num(), 1, 2, DocIds);
+	TestEqual(TEXT("Last page is exactly full"), DocIds, TArray<int32>{ 4, 6 });
+	Trie.Search(TEXT("rocks"), Docs.Num(), 2, 2, DocIds);
+	TestTrue(TEXT("Page right after a full last page is empty"), DocIds.IsEmpty());
+
+	Trie.Search(TEXT("rocks"), Docs.Num(), -1, 3, DocIds);
+	TestEqual(TEXT("Negative page is the first page"), DocIds, TArray<int32>{ 0, 2, 4 });
+	Trie.Search(TEXT("rocks"), Docs.Num(), 1, 0, DocIds);
+	TestEqual(TEXT("Empty pages hold one document"), DocIds, TArray<int32>{ 2 });
+	return true;
+}
+
+#endif
@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Th3PathMatcher.h"
+
+/*
+ * Rule checks for FTh3PathMatcher, run headless with e.g.
+ *   -nullrhi -ExecCmds="Automation RunTests Th3SMBuilder.PathMatcher; Quit"
+ */
+namespace Th3PathMatcherTests
+{
+	static constexpr uint32 TestFlags = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3PathMatcherRules, "Th3SMBuilder.PathMatcher.Rules", Th3PathMatcherTests::TestFlags)
+
+bool FTh3PathMatcherRules::RunTest(const FString& Parameters)
+{
+	FTh3PathMatcher Matcher;
+	Matcher.Compile({}, {});
+	TestTrue(TEXT("No rules keep everything"), Matcher.IsIncluded(TEXT("/Game/Props/SM_Crate")));
+
+	Matcher.Compile({}, { TEXT("/SomeMod") });
+	TestFalse(TEXT("Exclude rule"), Matcher.IsIncluded(TEXT("/SomeMod/Props/SM_Crate")));
+	TestTrue(TEXT("Only exclude rules keep the rest"), Matcher.IsIncluded(TEXT("/OtherMod/Props/SM_Crate")));
+	TestTrue(TEXT("Rules match whole folders"), Matcher.IsIncluded(TEXT("/SomeModExtras/Props/SM_Crate")));
+	TestFalse(TEXT("Rules ignore case like package names"), Matcher.IsIncluded(TEXT("/somemod/Props/SM_Crate")));
+
+	Matcher.Compile({ TEXT("/Game"), TEXT("/*/Rocks") }, { TEXT("/Game/FactoryGame") });
+	TestTrue(TEXT("Include rule"), Matcher.IsIncluded(TEXT("/Game/Props/SM_Crate")));
+	TestFalse(TEXT("More specific exclude rule"), Matcher.IsIncluded(TEXT("/Game/FactoryGame/Props/SM_Crate")));
+	TestTrue(TEXT("Wildcard include rule"), Matcher.IsIncluded(TEXT("/OtherMod/Rocks/SM_Rock")));
+	TestFalse(TEXT("Not in any include rule"), Matcher.IsIncluded(TEXT("/OtherMod/Props/SM_Crate")));
+
+	Matcher.Compile({ TEXT("/Game/FactoryGame") }, { TEXT("/Game") });
+	TestTrue(TEXT("More specific include rule"), Matcher.IsIncluded(TEXT("/Game/FactoryGame/Props/SM_Crate")));
+	TestFalse(TEXT("Less specific exclude rule"), Matcher.IsIncluded(TEXT("/Game/Props/SM_Crate")));
+
+	Matcher.Compile({ TEXT("/Game/Props") }, { TEXT("/*/Props") });
+	TestFalse(TEXT("Exclude rule wins a tie"), Matcher.IsIncluded(TEXT("/Game/Props/SM_Crate")));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTh3PathMatcherPatterns, "Th3SMBuilder.PathMatcher.Patterns", Th3PathMatcherTests::TestFlags)
+
+bool FTh3PathMatcherPatterns::RunTest(const FString& Parameters)
+{
+	FTh3PathMatcher Matcher;
+	Matcher.Compile({}, { TEXT("/ControlRig*") });
+	TestFalse(TEXT("Prefix pattern matches the plain name"), Matcher.IsIncluded(TEXT("/ControlRig/Controls/SM_Gizmo")));
+	TestFalse(TEXT("Prefix pattern matches longer names"), Matcher.IsIncluded(TEXT("/ControlRigModules/Modules/SM_Arm")));
+	TestFalse(TEXT("Prefix pattern matches other longer names"), Matcher.IsIncluded(TEXT("/ControlRigSpline/Meshes/SM_Spline")));
+	TestFalse(TEXT("Pattern matches folders never used as a name"), Matcher.IsIncluded(TEXT("/ControlRigTh3Unnamed/Meshes/SM_Spline")));
+	TestTrue(TEXT("Prefix pattern needs the whole prefix"), Matcher.IsIncluded(TEXT("/Control/Meshes/SM_Spline")));
+	TestTrue(TEXT("Pattern stays within one folder"), Matcher.IsIncluded(TEXT("/Game/ControlRig/SM_Gizmo")));
+
+	Matcher.Compile({}, { TEXT("/*/Dev*Assets") });
+	TestFalse(TEXT("Pattern with a star in the middle"), Matcher.IsIncluded(TEXT("/Game/DevTestAssets/SM_Crate")));
+	TestFalse(TEXT("Star matches nothing"), Matcher.IsIncluded(TEXT("/Game/DevAssets/SM_Crate")));
+	TestTrue(TEXT("Pattern has to match the end"), Matcher.IsIncluded(TEXT("/Game/DevAssetsOld/SM_Crate")));
+
+	Matcher.Compile({}, { TEXT("/*Mod/*_Old") });
+	TestFalse(TEXT("Several patterns in one rule"), Matcher.IsIncluded(TEXT("/SomeMod/Props_Old/SM_Crate")));
+	TestTrue(TEXT("Every pattern in the rule has to match"), Matcher.IsIncluded(TEXT("/SomeMod/Props/SM_Crate")));
+
+	Matcher.Compile({ TEXT("/Game/Dev*/Keep") }, { TEXT("/Game/Dev*") });
+	TestTrue(TEXT("Deeper rule wins over a pattern"), Matcher.IsIncluded(TEXT("/Game/DevStuff/Keep/SM_Crate")));
+	TestFalse(TEXT("Pattern rule applies elsewhere"), Matcher.IsIncluded(TEXT("/Game/DevStuff/Other/SM_Crate")));
+	return true;
+}
+
+#endif
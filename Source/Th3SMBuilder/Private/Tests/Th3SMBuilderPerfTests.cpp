@@ -0,0 +1,400 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Th3Utilities.h"
+#include "Th3SMBuilderBPFL.h"
+#include "Th3SearchIndex.h"
+#include "MaterialEntry.h"
+#include "Th3PathMatcher.h"
+#include "Th3TokenTrie.h"
+
+#include "Algo/Transform.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture2D.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialInstanceConstant.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+/*
+ * Performance tests for the hot loops, run headless with e.g.
+ *   -nullrhi -ExecCmds="Automation RunTests Th3SMBuilder.Perf; Quit"
+ * Every run appends its timings to Saved/Th3SMBuilder/PerfResults.csv.
+ */
+namespace Th3PerfTests
+{
+	static constexpr uint32 TestFlags = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter;
+	static constexpr int32 NumRuns = 7;
+
+	static const TCHAR* const Roots[] = { TEXT("/Game"), TEXT("/Game/FactoryGame"), TEXT("/SML"), TEXT("/SomeMod"), TEXT("/OtherMod") };
+	static const TCHAR* const Folders[] = { TEXT("Buildable"), TEXT("Props"), TEXT("Environment"), TEXT("Materials"), TEXT("Meshes"), TEXT("Rocks"), TEXT("Foliage") };
+	static const TCHAR* const Names[] = { TEXT("SM_Rock"), TEXT("M_Concrete"), TEXT("MI_Metal"), TEXT("SM_Pipe"), TEXT("SM_Crate"), TEXT("M_Glass"), TEXT("SM_Beam") };
+
+	/* Same paths for the same count on every run, so results can be compared */
+	static TArray<FString> MakeSyntheticPaths(const int32 Count)
+	{
+		FRandomStream Random(Count);
+		TArray<FString> Paths;
+		Paths.Reserve(Count);
+		for (int32 Idx = 0; Idx < Count; Idx++) {
+			const TCHAR* Root = Roots[Random.RandRange(0, UE_ARRAY_COUNT(Roots) - 1)];
+			const TCHAR* Folder = Folders[Random.RandRange(0, UE_ARRAY_COUNT(Folders) - 1)];
+			const TCHAR* Name = Names[Random.RandRange(0, UE_ARRAY_COUNT(Names) - 1)];
+			Paths.Add(FString::Printf(TEXT("%s/%s/%s_%d.%s_%d"), Root, Folder, Name, Idx, Name, Idx));
+		}
+		return Paths;
+	}
+
+	/* Objects of a few classes, for the class dispatching algos */
+	static TArray<UObject*> MakeSyntheticObjects(const int32 Count)
+	{
+		UObject* const Defaults[] = {
+			GetMutableDefault<UStaticMesh>(),
+			GetMutableDefault<UMaterial>(),
+			GetMutableDefault<UMaterialInstanceConstant>(),
+			GetMutableDefault<UTexture2D>(),
+		};
+		TArray<UObject*> Objects;
+		Objects.Reserve(Count);
+		for (int32 Idx = 0; Idx < Count; Idx++) {
+			Objects.Add(Defaults[Idx % UE_ARRAY_COUNT(Defaults)]);
+		}
+		return Objects;
+	}
+
+	struct FTiming
+	{
+		double MedianMs;
+		double MinMs;
+	};
+
+	template <typename FuncT>
+	static FTiming Measure(FuncT&& Func)
+	{
+		/* Warm up caches and allocators first */
+		Func();
+		TArray<double> Times;
+		for (int32 Run = 0; Run < NumRuns; Run++) {
+			const double Begin = FPlatformTime::Seconds();
+			Func();
+			Times.Add((FPlatformTime::Seconds() - Begin) * 1000.0);
+		}
+		Times.Sort();
+		return FTiming{ Times[NumRuns / 2], Times[0] };
+	}
+
+	static void Report(FAutomationTestBase& Test, const FString& Name, const int32 Count, const FTiming& Timing)
+	{
+		const double ItemsPerSec = Timing.MedianMs > 0.0 ? Count / (Timing.MedianMs / 1000.0) : 0.0;
+		Test.AddInfo(FString::Printf(TEXT("%s [%d]: median %.3f ms, min %.3f ms, %.0f items/s"), *Name, Count, Timing.MedianMs, Timing.MinMs, ItemsPerSec));
+
+		const FString CsvPath = FPaths::ProjectSavedDir() / TEXT("Th3SMBuilder") / TEXT("PerfResults.csv");
+		FString Line;
+		if (not FPaths::FileExists(CsvPath)) {
+			Line += TEXT("Timestamp,Build,Test,Count,Runs,MedianMs,MinMs,ItemsPerSec\n");
+		}
+		Line += FString::Printf(TEXT("%s,%s,%s,%d,%d,%.4f,%.4f,%.0f\n"), *FDateTime::UtcNow().ToIso8601(), *FEngineVersion::Current().ToString(), *Name, Count, NumRuns, Timing.MedianMs, Timing.MinMs, ItemsPerSec);
+		FFileHelper::SaveStringToFile(Line, *CsvPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+	}
+
+	static void GetSizes(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands)
+	{
+		for (const TCHAR* Size : { TEXT("1000"), TEXT("10000"), TEXT("100000") }) {
+			OutBeautifiedNames.Add(Size);
+			OutTestCommands.Add(Size);
+		}
+	}
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FTh3PerfTransformIfMulti, "Th3SMBuilder.Perf.TransformIfMulti", Th3PerfTests::TestFlags)
+
+void FTh3PerfTransformIfMulti::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	Th3PerfTests::GetSizes(OutBeautifiedNames, OutTestCommands);
+}
+
+bool FTh3PerfTransformIfMulti::RunTest(const FString& Parameters)
+{
+	const int32 Count = FCString::Atoi(*Parameters);
+	const TArray<FString> Paths = Th3PerfTests::MakeSyntheticPaths(Count);
+	using FPredicate = TFunction<bool(const FString&)>;
+	using FTransform = TFunction<int32(const FString&)>;
+	const TArray<TPair<FPredicate, FTransform>> TransMap = {
+		{ [](const FString& Path) { return Path.StartsWith(TEXT("/Game/")); }, [](const FString& Path) { return Path.Len(); } },
+		{ [](const FString& Path) { return Path.Contains(TEXT("Material")); }, [](const FString& Path) { return -Path.Len(); } },
+		{ [](const FString& Path) { return true; }, [](const FString& Path) { return 0; } },
+	};
+
+	TArray<int32> Output;
+	const Th3PerfTests::FTiming Timing = Th3PerfTests::Measure([&]() {
+		Output.Reset();
+		Th3Utilities::TransformIfMulti(Paths, Output, TransMap);
+	});
+	TestEqual(TEXT("Every path matches once"), Output.Num(), Count);
+	Th3PerfTests::Report(*this, TEXT("TransformIfMulti"), Count, Timing);
+	return true;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FTh3PerfForEachDynDispatch, "Th3SMBuilder.Perf.ForEachDynDispatch", Th3PerfTests::TestFlags)
+
+void FTh3PerfForEachDynDispatch::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	Th3PerfTests::GetSizes(OutBeautifiedNames, OutTestCommands);
+}
+
+bool FTh3PerfForEachDynDispatch::RunTest(const FString& Parameters)
+{
+	const int32 Count = FCString::Atoi(*Parameters);
+	const TArray<UObject*> Objects = Th3PerfTests::MakeSyntheticObjects(Count);
+	int32 Meshes = 0;
+	int32 Materials = 0;
+	const TMap<UClass*, TFunction<void(UObject*)>> CallMap = {
+		{ UStaticMesh::StaticClass(), [&Meshes](UObject*) { Meshes++; } },
+		{ UMaterialInterface::StaticClass(), [&Materials](UObject*) { Materials++; } },
+	};
+
+	const Th3PerfTests::FTiming Timing = Th3PerfTests::Measure([&]() {
+		Meshes = 0;
+		Materials = 0;
+		Th3Utilities::ForEachDynDispatch(Objects, CallMap);
+	});
+	TestEqual(TEXT("Meshes dispatched"), Meshes, (Count + 3) / 4);
+	TestEqual(TEXT("Materials dispatched"), Materials, (Count + 2) / 4 + (Count + 1) / 4);
+	Th3PerfTests::Report(*this, TEXT("ForEachDynDispatch"), Count, Timing);
+	return true;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FTh3PerfTransformDynDispatch, "Th3SMBuilder.Perf.TransformDynDispatch", Th3PerfTests::TestFlags)
+
+void FTh3PerfTransformDynDispatch::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	Th3PerfTests::GetSizes(OutBeautifiedNames, OutTestCommands);
+}
+
+bool FTh3PerfTransformDynDispatch::RunTest(const FString& Parameters)
+{
+	const int32 Count = FCString::Atoi(*Parameters);
+	const TArray<UObject*> Objects = Th3PerfTests::MakeSyntheticObjects(Count);
+	using FTransform = TFunction<Th3Optional<int32>(UObject*)>;
+	const TMap<UClass*, FTransform> TransMap = {
+		{ UStaticMesh::StaticClass(), [](UObject*) { return Th3Optional<int32>({ 1 }); } },
+		{ UMaterialInterface::StaticClass(), [](UObject*) { return Th3Optional<int32>({ 2 }); } },
+	};
+
+	TArray<int32> Output;
+	const Th3PerfTests::FTiming Timing = Th3PerfTests::Measure([&]() {
+		Output.Reset();
+		Th3Utilities::TransformDynDispatch(Objects, Output, TransMap);
+	});
+	TestEqual(TEXT("Textures are skipped"), Output.Num(), Count - Count / 4);
+	Th3PerfTests::Report(*this, TEXT("TransformDynDispatch"), Count, Timing);
+	return true;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FTh3PerfContainsAllWords, "Th3SMBuilder.Perf.ContainsAllWords", Th3PerfTests::TestFlags)
+
+void FTh3PerfContainsAllWords::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	Th3PerfTests::GetSizes(OutBeautifiedNames, OutTestCommands);
+}
+
+bool FTh3PerfContainsAllWords::RunTest(const FString& Parameters)
+{
+	const int32 Count = FCString::Atoi(*Parameters);
+	const TArray<FString> Paths = Th3PerfTests::MakeSyntheticPaths(Count);
+	const TArray<FString> Words = { TEXT("props"), TEXT("rock") };
+
+	int32 Matches = 0;
+	const Th3PerfTests::FTiming Timing = Th3PerfTests::Measure([&]() {
+		Matches = 0;
+		for (const FString& Path : Paths) {
+			Matches += UTh3SMBuilderBPFL::ContainsAllWords(Path, Words) ? 1 : 0;
+		}
+	});
+	Th3PerfTests::Report(*this, TEXT("ContainsAllWords"), Count, Timing);
+
+	TArray<int32> Indices;
+	const Th3PerfTests::FTiming BatchTiming = Th3PerfTests::Measure([&]() {
+		Indices.Reset();
+		UTh3SMBuilderBPFL::FindAllContainingWords(Indices, Paths, Words);
+	});
+	TestEqual(TEXT("Batch version finds the same matches"), Indices.Num(), Matches);
+	Th3PerfTests::Report(*this, TEXT("FindAllContainingWords"), Count, BatchTiming);
+	return true;
+}
+
+/* Measures the search index along both of its paths, see FilteredEntries for how the picker uses them */
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FTh3PerfSearchIndex, "Th3SMBuilder.Perf.SearchIndex", Th3PerfTests::TestFlags)
+
+void FTh3PerfSearchIndex::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	Th3PerfTests::GetSizes(OutBeautifiedNames, OutTestCommands);
+}
+
+bool FTh3PerfSearchIndex::RunTest(const FString& Parameters)
+{
+	const int32 Count = FCString::Atoi(*Parameters);
+	const TArray<FString> Paths = Th3PerfTests::MakeSyntheticPaths(Count);
+
+	FTh3SearchIndex Index;
+	const Th3PerfTests::FTiming BuildTiming = Th3PerfTests::Measure([&]() {
+		Index.Reset();
+		for (const FString& Path : Paths) {
+			Index.Add(Path);
+		}
+	});
+	Th3PerfTests::Report(*this, TEXT("SearchIndex.Build"), Count, BuildTiming);
+
+	const TArray<FString> Words = { TEXT("rock") };
+	const TArray<FString> Refined = { TEXT("rock"), TEXT("props") };
+	TArray<int32> Ids;
+	const Th3PerfTests::FTiming QueryTiming = Th3PerfTests::Measure([&]() {
+		Ids.Reset();
+		Index.Query(Words, Ids);
+	});
+	Th3PerfTests::Report(*this, TEXT("SearchIndex.Query"), Count, QueryTiming);
+
+	TArray<int32> RefinedIds;
+	const Th3PerfTests::FTiming RefineTiming = Th3PerfTests::Measure([&]() {
+		RefinedIds.Reset();
+		Index.Filter(Ids, Refined, RefinedIds);
+	});
+	Th3PerfTests::Report(*this, TEXT("SearchIndex.Refine"), Count, RefineTiming);
+
+	TArray<int32> Expected;
+	UTh3SMBuilderBPFL::FindAllContainingWords(Expected, Paths, Refined);
+	TestEqual(TEXT("Refining finds the same matches as a full scan"), RefinedIds, Expected);
+	return true;
+}
+
+/*
+ * Same code path as ATh3SMBuilderSubsystem::GetFilteredEntries, which lives on a
+ * spawned subsystem actor: typing a query one character at a time, then mapping
+ * the ids of every step to material entries.
+ */
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FTh3PerfFilteredEntries, "Th3SMBuilder.Perf.FilteredEntries", Th3PerfTests::TestFlags)
+
+void FTh3PerfFilteredEntries::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	Th3PerfTests::GetSizes(OutBeautifiedNames, OutTestCommands);
+}
+
+bool FTh3PerfFilteredEntries::RunTest(const FString& Parameters)
+{
+	const int32 Count = FCString::Atoi(*Parameters);
+	const TArray<FString> Paths = Th3PerfTests::MakeSyntheticPaths(Count);
+
+	/* Nothing collects garbage while the test runs, so the entries need no references */
+	TArray<UMaterialEntry*> Entries;
+	FTh3SearchIndex Index;
+	for (const FString& Path : Paths) {
+		UMaterialEntry* Entry = NewObject<UMaterialEntry>();
+		Entry->MaterialPtr = TSoftObjectPtr<UMaterialInterface>(FSoftObjectPath(Path));
+		Index.Add(Entry->MaterialPtr.ToString(), TEXT("Surface"));
+		Entries.Add(Entry);
+	}
+
+	const FString Typed = TEXT("rock props");
+	FTh3IncrementalSearch Search;
+	TArray<UMaterialEntry*> Filtered;
+	const Th3PerfTests::FTiming Timing = Th3PerfTests::Measure([&]() {
+		Search.Reset();
+		for (int32 Len = 1; Len <= Typed.Len(); Len++) {
+			TArray<FString> Words;
+			Typed.Left(Len).ParseIntoArrayWS(Words);
+			Filtered.Reset();
+			Algo::Transform(Search.Search(Index, Words), Filtered, [&Entries](const int32 Id) { return Entries[Id]; });
+		}
+	});
+	Th3PerfTests::Report(*this, TEXT("FilteredEntries.Typing"), Count, Timing);
+
+	TArray<int32> Expected;
+	UTh3SMBuilderBPFL::FindAllContainingWords(Expected, Paths, { TEXT("rock"), TEXT("props") });
+	TestEqual(TEXT("Typing ends with the same matches as a full scan"), Filtered.Num(), Expected.Num());
+	return true;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FTh3PerfPathMatcher, "Th3SMBuilder.Perf.PathMatcher", Th3PerfTests::TestFlags)
+
+void FTh3PerfPathMatcher::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	Th3PerfTests::GetSizes(OutBeautifiedNames, OutTestCommands);
+}
+
+bool FTh3PerfPathMatcher::RunTest(const FString& Parameters)
+{
+	const int32 Count = FCString::Atoi(*Parameters);
+	TArray<FName> Packages;
+	Algo::Transform(Th3PerfTests::MakeSyntheticPaths(Count), Packages, [](const FString& Path) { return FName(*Path); });
+
+	int32 Expected = 0;
+	const Th3PerfTests::FTiming PrefixTiming = Th3PerfTests::Measure([&]() {
+		Expected = 0;
+		for (const FName Package : Packages) {
+			Expected += Package.ToString().StartsWith(TEXT("/SomeMod")) ? 0 : 1;
+		}
+	});
+	Th3PerfTests::Report(*this, TEXT("PathMatcher.StartsWith"), Count, PrefixTiming);
+
+	FTh3PathMatcher Matcher;
+	Matcher.Compile({}, { TEXT("/SomeMod") });
+	int32 Included = 0;
+	const Th3PerfTests::FTiming MatchTiming = Th3PerfTests::Measure([&]() {
+		Included = 0;
+		for (const FName Package : Packages) {
+			Included += Matcher.IsIncluded(Package) ? 1 : 0;
+		}
+	});
+	Th3PerfTests::Report(*this, TEXT("PathMatcher.IsIncluded"), Count, MatchTiming);
+	TestEqual(TEXT("Matcher keeps the same packages as a prefix check"), Included, Expected);
+	return true;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FTh3PerfMeshSearch, "Th3SMBuilder.Perf.MeshSearch", Th3PerfTests::TestFlags)
+
+void FTh3PerfMeshSearch::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	Th3PerfTests::GetSizes(OutBeautifiedNames, OutTestCommands);
+}
+
+bool FTh3PerfMeshSearch::RunTest(const FString& Parameters)
+{
+	const int32 Count = FCString::Atoi(*Parameters);
+	const TArray<FString> Paths = Th3PerfTests::MakeSyntheticPaths(Count);
+
+	FTh3TokenTrie Trie;
+	const Th3PerfTests::FTiming BuildTiming = Th3PerfTests::Measure([&]() {
+		Trie.Reset();
+		TArray<FString> Tokens;
+		for (int32 DocId = 0; DocId < Paths.Num(); DocId++) {
+			Tokens.Reset();
+			FTh3TokenTrie::Tokenize(Paths[DocId], Tokens);
+			for (const FString& Token : Tokens) {
+				Trie.Add(DocId, Token);
+			}
+		}
+		Trie.Build();
+	});
+	Th3PerfTests::Report(*this, TEXT("MeshSearch.Build"), Count, BuildTiming);
+
+	TBitArray<> Docs;
+	const Th3PerfTests::FTiming QueryTiming = Th3PerfTests::Measure([&]() {
+		Docs.Init(false, Paths.Num());
+		Trie.FindPrefix(TEXT("roc"), Docs);
+	});
+	Th3PerfTests::Report(*this, TEXT("MeshSearch.FindPrefix"), Count, QueryTiming);
+
+	int32 Expected = 0;
+	for (const FString& Path : Paths) {
+		Expected += Path.Contains(TEXT("/Rocks/")) or Path.Contains(TEXT("SM_Rock")) ? 1 : 0;
+	}
+	TestEqual(TEXT("Prefix finds every path with a word starting with it"), Docs.CountSetBits(), Expected);
+	return true;
+}
+
+#endif
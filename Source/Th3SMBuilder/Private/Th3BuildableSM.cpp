@@ -2,7 +2,14 @@
 
 #include "Th3BuildableSM.h"
 #include "Th3SMBuilder.h"
+#include "Th3InstanceManager.h"
+#include "Th3SMBuilderSavePalette.h"
+#include "Th3CollisionManager.h"
+#include "Th3MeshResidency.h"
+#include "Th3SMBuilderRCO.h"
+#include "Components/BoxComponent.h"
 #include "FGCharacterPlayer.h"
+#include "Net/UnrealNetwork.h"
 
 #define COLLISION_CHANNEL_BUILDGUN	(ECollisionChannel::ECC_GameTraceChannel5)
 #define COLLISION_CHANNEL_INTERACT	(ECollisionChannel::ECC_GameTraceChannel13)
@@ -17,12 +24,19 @@ ATh3BuildableSM::ATh3BuildableSM(const FObjectInitializer& ObjectInitializer) :
 		/* Ugly, but CDO property propagation doesn't work for runtime generated classes */
 		ATh3BuildableSM* CDO = GetSubclassDefault();
 		Mesh = CDO->Mesh;
+		MeshPtr = CDO->MeshPtr;
+		MeshId = CDO->MeshId;
 		mDisplayName = CDO->mDisplayName;
 		mHologramClass = CDO->mHologramClass;
 		mInteractWidgetSoftClass = CDO->mInteractWidgetSoftClass;
 		FallbackMaterial = CDO->FallbackMaterial;
 		CollisionProfile = CDO->CollisionProfile;
+		bUseInstancedRendering = CDO->bUseInstancedRendering;
+		CollisionPolicy = CDO->CollisionPolicy;
 		if (not Mesh) {
+			Mesh = MeshPtr.Get();
+		}
+		if (MeshPtr.IsNull()) {
 			UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("[%s] MESH NOT SET FOR %s"), *FString(__func__), *this->GetPathName());
 		}
 		if (not FallbackMaterial) {
@@ -41,7 +55,15 @@ ATh3BuildableSM::ATh3BuildableSM(const FObjectInitializer& ObjectInitializer) :
 	//MeshComponent->SetCollisionObjectType(ECollisionChannel::ECC_WorldStatic);
 	MeshComponent->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Block);
 	MeshComponent->SetCollisionProfileName(CollisionProfile.Name, true);
-	MeshComponent->UpdateCollisionFromStaticMesh();
+
+	BoundsComponent = CreateDefaultSubobject<UBoxComponent>(TEXT("BoundsComponent0"));
+	BoundsComponent->Mobility = EComponentMobility::Movable;
+	BoundsComponent->SetupAttachment(RootComponent);
+	BoundsComponent->SetCollisionProfileName(CollisionProfile.Name, false);
+	UpdateBounds();
+
+	/* Nothing gets created for a disabled component, so this is cheap until upgraded */
+	SetFullCollision(CollisionPolicy == ETh3CollisionPolicy::Full);
 }
 
 ATh3BuildableSM::~ATh3BuildableSM()
@@ -57,9 +79,88 @@ void ATh3BuildableSM::SetMesh(UStaticMesh* NewMesh)
 	}
 	Mesh = NewMesh;
 	MeshComponent->SetStaticMesh(Mesh);
+	UpdateBounds();
 	for (int32 Index = 0; Index < OverriddenMaterials.Num(); Index++) {
 		MeshComponent->SetMaterial(Index, OverriddenMaterials[Index]);
 	}
+	if (HasActorBegunPlay()) {
+		UpdateInstance();
+	}
+}
+
+void ATh3BuildableSM::SetFullCollision(bool bFull)
+{
+	bFullCollision = bFull;
+	if (bFull) {
+		/* Registered first, there is no physics state to update otherwise */
+		UpdateMeshRegistration();
+		MeshComponent->SetCollisionProfileName(CollisionProfile.Name, true);
+		MeshComponent->UpdateCollisionFromStaticMesh();
+	} else {
+		MeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		UpdateMeshRegistration();
+	}
+	if (BoundsComponent) {
+		BoundsComponent->SetCollisionEnabled(bFull ? ECollisionEnabled::NoCollision : ECollisionEnabled::QueryAndPhysics);
+	}
+}
+
+FBox ATh3BuildableSM::GetCollisionBounds() const
+{
+	if (not BoundsComponent) {
+		return FBox(GetActorLocation(), GetActorLocation());
+	}
+	return BoundsComponent->CalcBounds(BoundsComponent->GetComponentTransform()).GetBox();
+}
+
+void ATh3BuildableSM::UpdateBounds()
+{
+	if (not BoundsComponent or not Mesh) {
+		return;
+	}
+	const FBoxSphereBounds Bounds = Mesh->GetBounds();
+	BoundsComponent->SetRelativeLocation(Bounds.Origin);
+	BoundsComponent->SetBoxExtent(Bounds.BoxExtent, false);
+}
+
+void ATh3BuildableSM::UpdateInstance()
+{
+	UTh3InstanceManager* InstanceManager = UTh3InstanceManager::Get(this);
+	if (not InstanceManager) {
+		return;
+	}
+	/* Not from the component, which does not follow the actor while unregistered */
+	const FTransform Transform = MeshComponent->GetRelativeTransform() * GetActorTransform();
+	bDrawnAsInstance = bUseInstancedRendering and Mesh and InstanceManager->AddInstance(this, Mesh, MeshComponent->GetMaterials(), Transform);
+	if (not bDrawnAsInstance) {
+		InstanceManager->RemoveInstance(this);
+	}
+	/* Only hidden when it stays registered for its collision */
+	MeshComponent->SetVisibility(not bDrawnAsInstance);
+	UpdateMeshRegistration();
+}
+
+void ATh3BuildableSM::UpdateMeshRegistration()
+{
+	/* Components get registered on their own until then */
+	if (not MeshComponent or not IsActorInitialized()) {
+		return;
+	}
+	const bool bNeeded = not bDrawnAsInstance or bFullCollision;
+	if (bNeeded and not MeshComponent->IsRegistered()) {
+		MeshComponent->RegisterComponent();
+	} else if (not bNeeded and MeshComponent->IsRegistered()) {
+		MeshComponent->UnregisterComponent();
+	}
+}
+
+UStaticMesh* ATh3BuildableSM::EnsureMeshLoaded(UObject* WorldContext)
+{
+	if (not Mesh and not MeshPtr.IsNull()) {
+		UTh3MeshResidency* MeshResidency = UTh3MeshResidency::Get(WorldContext ? WorldContext : this);
+		SetMesh(MeshResidency ? MeshResidency->Touch(MeshPtr) : MeshPtr.LoadSynchronous());
+	}
+	return Mesh;
 }
 
 void ATh3BuildableSM::SetMaterialForIndex(int32 Index, UMaterialInterface* InMaterial)
@@ -84,6 +185,14 @@ void ATh3BuildableSM::SetMaterialForIndex(int32 Index, UMaterialInterface* InMat
 		}
 	}
 	OverriddenMaterials[Index] = Material;
+	UpdateInstance();
+
+	if (HasAuthority()) {
+		/* Buildables are dormant, so the change would not replicate otherwise */
+		FlushNetDormancy();
+	} else {
+		UTh3SMBuilderRCO::SetBuildableMaterial(this, Index, InMaterial);
+	}
 
 	UE_LOG(LogTh3SMBuilderCpp, Warning, TEXT("[%s] Materials for %s:"), *FString(__func__), *this->GetPathName());
 	for (int32 Idx = 0; Idx < OverriddenMaterials.Num(); Idx++) {
@@ -91,6 +200,30 @@ void ATh3BuildableSM::SetMaterialForIndex(int32 Index, UMaterialInterface* InMat
 	}
 }
 
+int32 ATh3BuildableSM::GetNumMaterialSlots() const
+{
+	return MeshComponent ? MeshComponent->GetNumMaterials() : 0;
+}
+
+void ATh3BuildableSM::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	AFGBuildable::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(ATh3BuildableSM, OverriddenMaterials);
+}
+
+void ATh3BuildableSM::OnRep_OverriddenMaterials()
+{
+	/* BeginPlay applies them the first time */
+	if (not MeshComponent or not HasActorBegunPlay()) {
+		return;
+	}
+	for (int32 Index = 0; Index < OverriddenMaterials.Num(); Index++) {
+		UMaterialInterface* Material = OverriddenMaterials[Index];
+		MeshComponent->SetMaterial(Index, IsValid(Material) ? Material : FallbackMaterial);
+	}
+	UpdateInstance();
+}
+
 void ATh3BuildableSM::BeginPlay()
 {
 	AFGBuildable::BeginPlay();
@@ -100,9 +233,24 @@ void ATh3BuildableSM::BeginPlay()
 		return;
 	}
 
+	/* Acquired first, so that loading it cannot evict it right away */
+	UTh3MeshResidency* MeshResidency = UTh3MeshResidency::Get(this);
+	if (MeshResidency and not MeshPtr.IsNull()) {
+		MeshResidency->Acquire(MeshPtr);
+		bHoldsMesh = true;
+	}
+	EnsureMeshLoaded();
+
 	if (OverriddenMaterials.IsEmpty()) {
 		OverriddenMaterials = MeshComponent->GetMaterials();
 	}
+	for (const TPair<int32, UMaterialInterface*>& Delta : PendingMaterialDeltas) {
+		if (OverriddenMaterials.Num() <= Delta.Key) {
+			OverriddenMaterials.SetNumZeroed(Delta.Key + 1);
+		}
+		OverriddenMaterials[Delta.Key] = Delta.Value;
+	}
+	PendingMaterialDeltas.Empty();
 	UE_LOG(LogTh3SMBuilderCpp, Warning, TEXT("Got %d material slots for %s"), OverriddenMaterials.Num(), *this->GetPathName());
 	for (int32 Index = 0; Index < OverriddenMaterials.Num(); Index++) {
 		UMaterialInterface* Material = OverriddenMaterials[Index];
@@ -111,6 +259,91 @@ void ATh3BuildableSM::BeginPlay()
 		}
 		MeshComponent->SetMaterial(Index, Material);
 	}
+	UpdateInstance();
+
+	if (CollisionPolicy == ETh3CollisionPolicy::Proximity) {
+		if (UTh3CollisionManager* CollisionManager = UTh3CollisionManager::Get(this)) {
+			CollisionManager->Register(this);
+		} else {
+			SetFullCollision(true);
+		}
+	}
+}
+
+void ATh3BuildableSM::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTh3CollisionManager* CollisionManager = UTh3CollisionManager::Get(this)) {
+		CollisionManager->Unregister(this);
+	}
+	if (UTh3InstanceManager* InstanceManager = UTh3InstanceManager::Get(this)) {
+		InstanceManager->RemoveInstance(this);
+	}
+	if (bHoldsMesh) {
+		if (UTh3MeshResidency* MeshResidency = UTh3MeshResidency::Get(this)) {
+			MeshResidency->Release(MeshPtr);
+		}
+		bHoldsMesh = false;
+	}
+	AFGBuildable::EndPlay(EndPlayReason);
+}
+
+void ATh3BuildableSM::WriteToPalette(ATh3SMBuilderSavePalette& Palette)
+{
+	SavedMaterialDeltas.Reset();
+	/* Deltas need the default materials, without the mesh they are saved inline like before */
+	const UStaticMesh* DefaultMesh = Mesh ? Mesh : MeshPtr.Get();
+	if (DefaultMesh) {
+		for (int32 Index = 0; Index < OverriddenMaterials.Num(); Index++) {
+			if (OverriddenMaterials[Index] != DefaultMesh->GetMaterial(Index)) {
+				SavedMaterialDeltas.Add(Index);
+				SavedMaterialDeltas.Add(Palette.AddMaterial(OverriddenMaterials[Index]));
+			}
+		}
+		StashedMaterials = MoveTemp(OverriddenMaterials);
+		OverriddenMaterials.Reset();
+	}
+	SavedSearchString = SearchString.IsEmpty() ? INDEX_NONE : Palette.AddString(SearchString);
+	StashedSearchString = MoveTemp(SearchString);
+	SearchString.Reset();
+}
+
+void ATh3BuildableSM::PostSaveGame_Implementation(int32 saveVersion, int32 gameVersion)
+{
+	AFGBuildable::PostSaveGame_Implementation(saveVersion, gameVersion);
+
+	/* Only empty if they were stashed by WriteToPalette */
+	if (OverriddenMaterials.IsEmpty()) {
+		OverriddenMaterials = MoveTemp(StashedMaterials);
+	}
+	if (SearchString.IsEmpty()) {
+		SearchString = MoveTemp(StashedSearchString);
+	}
+	StashedMaterials.Reset();
+	StashedSearchString.Reset();
+	SavedMaterialDeltas.Reset();
+	SavedSearchString = INDEX_NONE;
+}
+
+void ATh3BuildableSM::PostLoadGame_Implementation(int32 saveVersion, int32 gameVersion)
+{
+	AFGBuildable::PostLoadGame_Implementation(saveVersion, gameVersion);
+
+	if (SavedMaterialDeltas.IsEmpty() and SavedSearchString == INDEX_NONE) {
+		return;
+	}
+	const ATh3SMBuilderSavePalette* Palette = ATh3SMBuilderSavePalette::Get(this);
+	if (not Palette) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("[%s] NO SAVE PALETTE FOR %s"), *FString(__func__), *this->GetPathName());
+		return;
+	}
+	for (int32 Idx = 0; Idx + 1 < SavedMaterialDeltas.Num(); Idx += 2) {
+		PendingMaterialDeltas.Emplace(SavedMaterialDeltas[Idx], Palette->GetMaterial(SavedMaterialDeltas[Idx + 1]));
+	}
+	if (SavedSearchString != INDEX_NONE) {
+		SearchString = Palette->GetString(SavedSearchString);
+	}
+	SavedMaterialDeltas.Reset();
+	SavedSearchString = INDEX_NONE;
 }
 
 FText ATh3BuildableSM::GetSearchText() const
@@ -129,6 +362,13 @@ void ATh3BuildableSM::StartIsLookedAtForDismantle_Implementation(AFGCharacterPla
 {
 	//UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("[%s] %s by %s"), *FString(__func__), *Th3::GetPathSafe(this), *Th3::GetPathSafe(byCharacter));
 
+	/* The build gun found the bounding box, switch to the real shape for the highlight */
+	if (CollisionPolicy == ETh3CollisionPolicy::Proximity) {
+		if (UTh3CollisionManager* CollisionManager = UTh3CollisionManager::Get(this)) {
+			CollisionManager->Pin(this);
+		}
+	}
+
 	AFGBuildable::StartIsLookedAtForDismantle_Implementation(byCharacter);
 }
 
@@ -136,5 +376,11 @@ void ATh3BuildableSM::StopIsLookedAtForDismantle_Implementation(AFGCharacterPlay
 {
 	//UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("[%s] %s by %s"), *FString(__func__), *Th3::GetPathSafe(this), *Th3::GetPathSafe(byCharacter));
 
+	if (CollisionPolicy == ETh3CollisionPolicy::Proximity) {
+		if (UTh3CollisionManager* CollisionManager = UTh3CollisionManager::Get(this)) {
+			CollisionManager->Unpin(this);
+		}
+	}
+
 	AFGBuildable::StopIsLookedAtForDismantle_Implementation(byCharacter);
 }
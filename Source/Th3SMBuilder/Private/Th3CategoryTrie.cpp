@@ -0,0 +1,226 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3CategoryTrie.h"
+
+#include "Algo/Sort.h"
+
+void FTh3CategoryTrie::Build(TConstArrayView<FString> PackagePaths, const int32 MaxCategories, const int32 MaxSubCategories)
+{
+	Nodes.Reset();
+	Categories.Reset();
+	SubCategories.Reset();
+	DirectCategories.Reset();
+	WholeCategories.Reset();
+	DirectSubCategories.Reset();
+	WholeSubCategories.Reset();
+	Nodes.AddDefaulted();
+
+	TArray<FString> Segments;
+	for (const FString& PackagePath : PackagePaths) {
+		/* The last segment is the asset itself */
+		PackagePath.ParseIntoArray(Segments, TEXT("/"));
+		int32 Node = 0;
+		Nodes[Node].NumTotal++;
+		for (int32 Idx = 0; Idx + 1 < Segments.Num(); Idx++) {
+			const int32* Found = Nodes[Node].Children.Find(Segments[Idx]);
+			int32 Child = Found ? *Found : INDEX_NONE;
+			if (not Found) {
+				Child = Nodes.AddDefaulted();
+				Nodes[Child].Parent = Node;
+				Nodes[Child].Path = Nodes[Node].Path / Segments[Idx];
+				Nodes[Node].Children.Add(Segments[Idx], Child);
+			}
+			Node = Child;
+			Nodes[Node].NumTotal++;
+		}
+		Nodes[Node].NumDirect++;
+	}
+	for (FNode& Node : Nodes) {
+		Node.Children.GenerateValueArray(Node.SortedChildren);
+		Algo::Sort(Node.SortedChildren, [this](const int32 A, const int32 B) { return Nodes[A].Path < Nodes[B].Path; });
+	}
+
+	const auto make_label = [this](const FPart& Part, const FString& Prefix) {
+		const auto node_label = [this, &Prefix](const int32 Node) {
+			FString Label = Nodes[Node].Path;
+			Label.RemoveFromStart(Prefix);
+			Label.RemoveFromStart(TEXT("/"));
+			if (Label.IsEmpty()) {
+				Label = FPaths::GetPathLeaf(Nodes[Node].Path);
+			}
+			return Label;
+		};
+		if (Part.First != INDEX_NONE) {
+			const TArray<int32>& Children = Nodes[Part.Node].SortedChildren;
+			return node_label(Children[Part.First]) + TEXT(" - ") + node_label(Children[Part.Last]);
+		}
+		const FString Label = node_label(Part.Node);
+		/* Only the root has no path at all */
+		return Label.IsEmpty() ? FString(TEXT("All")) : Label;
+	};
+	const auto add_part = [this](const FPart& Part, const int32 Group, TMap<int32, int32>& Direct, TMap<int32, int32>& Whole) {
+		if (Part.bDirectOnly) {
+			Direct.Add(Part.Node, Group);
+		} else if (Part.First == INDEX_NONE) {
+			Whole.Add(Part.Node, Group);
+		} else {
+			for (int32 Idx = Part.First; Idx <= Part.Last; Idx++) {
+				Whole.Add(Nodes[Part.Node].SortedChildren[Idx], Group);
+			}
+		}
+	};
+
+	TArray<FPart> CategoryParts;
+	Partition(FPart{ 0 }, MaxCategories, CategoryParts);
+	for (const FPart& Category : CategoryParts) {
+		const int32 CategoryId = Categories.Add(FGroup{ make_label(Category, FString()) });
+		add_part(Category, CategoryId, DirectCategories, WholeCategories);
+
+		TArray<FPart> SubCategoryParts;
+		Partition(Category, MaxSubCategories, SubCategoryParts);
+		for (const FPart& SubCategory : SubCategoryParts) {
+			const int32 SubCategoryId = SubCategories.Add(FGroup{ make_label(SubCategory, Nodes[Category.Node].Path), CategoryId });
+			add_part(SubCategory, SubCategoryId, DirectSubCategories, WholeSubCategories);
+		}
+	}
+}
+
+int32 FTh3CategoryTrie::GetNumPieces(const FPart& Part) const
+{
+	const FNode& Node = Nodes[Part.Node];
+	if (Part.bDirectOnly) {
+		return 0;
+	}
+	if (Part.First != INDEX_NONE) {
+		return Part.Last - Part.First + 1;
+	}
+	return Node.Children.IsEmpty() ? 0 : Node.Children.Num() + (Node.NumDirect > 0 ? 1 : 0);
+}
+
+int32 FTh3CategoryTrie::GetNumTotal(const FPart& Part) const
+{
+	const FNode& Node = Nodes[Part.Node];
+	if (Part.bDirectOnly) {
+		return Node.NumDirect;
+	}
+	if (Part.First == INDEX_NONE) {
+		return Node.NumTotal;
+	}
+	int32 NumTotal = 0;
+	for (int32 Idx = Part.First; Idx <= Part.Last; Idx++) {
+		NumTotal += Nodes[Node.SortedChildren[Idx]].NumTotal;
+	}
+	return NumTotal;
+}
+
+const FString& FTh3CategoryTrie::GetSortPath(const FPart& Part) const
+{
+	return Nodes[Part.First != INDEX_NONE ? Nodes[Part.Node].SortedChildren[Part.First] : Part.Node].Path;
+}
+
+void FTh3CategoryTrie::Split(const FPart& Part, const int32 NumGroups, TArray<FPart>& out_Parts) const
+{
+	const FNode& Node = Nodes[Part.Node];
+	const bool bRange = Part.First != INDEX_NONE;
+	const int32 First = bRange ? Part.First : 0;
+	const int32 Count = bRange ? Part.Last - Part.First + 1 : Node.SortedChildren.Num();
+	int32 NumRanges = NumGroups == INDEX_NONE ? Count : NumGroups;
+	if (not bRange and Node.NumDirect > 0) {
+		out_Parts.Add(FPart{ Part.Node, true });
+		if (NumGroups != INDEX_NONE) {
+			NumRanges--;
+		}
+	}
+	/* Evenly sized, and ranges of a single child are that child */
+	for (int32 Range = 0; Range < NumRanges; Range++) {
+		const int32 Begin = First + Count * Range / NumRanges;
+		const int32 End = First + Count * (Range + 1) / NumRanges - 1;
+		if (Begin == End) {
+			out_Parts.Add(FPart{ Node.SortedChildren[Begin] });
+		} else if (Begin < End) {
+			out_Parts.Add(FPart{ Part.Node, false, Begin, End });
+		}
+	}
+}
+
+void FTh3CategoryTrie::Partition(const FPart& Whole, const int32 MaxParts, TArray<FPart>& out_Parts) const
+{
+	const int32 Limit = FMath::Max(MaxParts, 1);
+	out_Parts.Reset();
+	out_Parts.Add(Whole);
+	for (;;) {
+		/* Split the largest part that still fits within the limit once split */
+		int32 Best = INDEX_NONE;
+		/* Otherwise the largest part that would never fit, into as many ranges as there is room for */
+		int32 BestRanged = INDEX_NONE;
+		const int32 Room = Limit - out_Parts.Num() + 1;
+		for (int32 Idx = 0; Idx < out_Parts.Num(); Idx++) {
+			const int32 NumPieces = GetNumPieces(out_Parts[Idx]);
+			const int32 NumTotal = GetNumTotal(out_Parts[Idx]);
+			if (NumPieces == 0) {
+				continue;
+			}
+			if (NumPieces <= Room) {
+				if (Best == INDEX_NONE or NumTotal > GetNumTotal(out_Parts[Best])) {
+					Best = Idx;
+				}
+			} else if (NumPieces > Limit and Room >= 2) {
+				if (BestRanged == INDEX_NONE or NumTotal > GetNumTotal(out_Parts[BestRanged])) {
+					BestRanged = Idx;
+				}
+			}
+		}
+		if (Best == INDEX_NONE and BestRanged == INDEX_NONE) {
+			break;
+		}
+		const FPart Part = out_Parts[Best != INDEX_NONE ? Best : BestRanged];
+		out_Parts.RemoveAtSwap(Best != INDEX_NONE ? Best : BestRanged);
+		Split(Part, Best != INDEX_NONE ? INDEX_NONE : Room, out_Parts);
+	}
+	/* Stable menu order, independent of the order paths were added in */
+	Algo::Sort(out_Parts, [this](const FPart& A, const FPart& B) {
+		const FString& PathA = GetSortPath(A);
+		const FString& PathB = GetSortPath(B);
+		return PathA != PathB ? PathA < PathB : A.bDirectOnly > B.bDirectOnly;
+	});
+}
+
+int32 FTh3CategoryTrie::FindNode(const FString& PackagePath) const
+{
+	if (Nodes.IsEmpty()) {
+		return INDEX_NONE;
+	}
+	TArray<FString> Segments;
+	PackagePath.ParseIntoArray(Segments, TEXT("/"));
+	int32 Node = 0;
+	for (int32 Idx = 0; Idx + 1 < Segments.Num(); Idx++) {
+		const int32* Child = Nodes[Node].Children.Find(Segments[Idx]);
+		if (not Child) {
+			return INDEX_NONE;
+		}
+		Node = *Child;
+	}
+	return Node;
+}
+
+int32 FTh3CategoryTrie::FindGroup(int32 Node, const TMap<int32, int32>& Direct, const TMap<int32, int32>& Whole) const
+{
+	if (const int32* Found = Direct.Find(Node)) {
+		return *Found;
+	}
+	for (; Node != INDEX_NONE; Node = Nodes[Node].Parent) {
+		if (const int32* Found = Whole.Find(Node)) {
+			return *Found;
+		}
+	}
+	return INDEX_NONE;
+}
+
+TPair<int32, int32> FTh3CategoryTrie::Find(const FString& PackagePath) const
+{
+	const int32 Node = FindNode(PackagePath);
+	if (Node == INDEX_NONE) {
+		return TPair<int32, int32>(INDEX_NONE, INDEX_NONE);
+	}
+	return TPair<int32, int32>(FindGroup(Node, DirectCategories, WholeCategories), FindGroup(Node, DirectSubCategories, WholeSubCategories));
+}
@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3ClassGenerator.h"
+#include "Th3SMBuilder.h"
+#include "Th3SMBuilderStats.h"
+
+#include "Reflection/ClassGenerator.h"
+
+void FTh3ClassGenerator::Reserve(const int32 NumClasses)
+{
+	Generated.Reserve(Generated.Num() + NumClasses);
+	Claimed.Reserve(Claimed.Num() + NumClasses);
+}
+
+FName FTh3ClassGenerator::MakeUniqueName(const FName Package, const FString& Name, const FString& Key) const
+{
+	const FName Plain(*Name);
+	if (not IsTaken(FTopLevelAssetPath(Package, Plain))) {
+		return Plain;
+	}
+	uint32 Hash = FCrc::StrCrc32(*Key);
+	for (;;) {
+		const FName Suffixed(*FString::Printf(TEXT("%s_%08X"), *Name, Hash));
+		if (not IsTaken(FTopLevelAssetPath(Package, Suffixed))) {
+			return Suffixed;
+		}
+		/* Only if two keys have the same CRC, still deterministic */
+		Hash = HashCombine(Hash, 1);
+	}
+}
+
+FName FTh3ClassGenerator::ClaimUniqueName(const FName Package, const FName Name, const FString& Key)
+{
+	const FName Unique = IsTaken(FTopLevelAssetPath(Package, Name)) ? MakeUniqueName(Package, Name.ToString(), Key) : Name;
+	Claimed.Add(FTopLevelAssetPath(Package, Unique));
+	return Unique;
+}
+
+UClass* FTh3ClassGenerator::Generate(const FName Package, const FName Name, UClass* ParentClass)
+{
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_GenerateClass);
+	if (Name.IsNone()) {
+		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Name was empty, can't create class"));
+		return nullptr;
+	}
+	bool bAlreadyGenerated = false;
+	Generated.Add(FTopLevelAssetPath(Package, Name), &bAlreadyGenerated);
+	if (bAlreadyGenerated) {
+		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Class %s.%s was already generated"), *Package.ToString(), *Name.ToString());
+		return nullptr;
+	}
+#if DO_CHECK
+	/* Too slow to do for every class in shipping, but catches classes not made through here */
+	if (FindObject<UClass>(FTopLevelAssetPath(Package, Name))) {
+		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Class %s.%s already exists"), *Package.ToString(), *Name.ToString());
+		return nullptr;
+	}
+	if (FindObject<UClass>(FTopLevelAssetPath(Package, FName(Name.ToString() + TEXT("_C"))))) {
+		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Class %s.%s_C already exists"), *Package.ToString(), *Name.ToString());
+		return nullptr;
+	}
+#endif
+	/* Packages are created once and then found again by name */
+	return FClassGenerator::GenerateSimpleClass(*Package.ToString(), *Name.ToString(), ParentClass);
+}
@@ -0,0 +1,182 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3CollisionManager.h"
+#include "Th3SMBuilder.h"
+#include "Th3BuildableSM.h"
+#include "Th3SMBuilderRootInstance.h"
+
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+
+UTh3CollisionManager* UTh3CollisionManager::Get(const UObject* WorldContext)
+{
+	const UWorld* World = WorldContext ? WorldContext->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UTh3CollisionManager>() : nullptr;
+}
+
+void UTh3CollisionManager::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	if (const UTh3SMBuilderRootInstance* RootInstance = UTh3SMBuilderRootInstance::Get(GetWorld())) {
+		Radius = FMath::Max(RootInstance->ProximityCollisionRadius, 100.0f);
+		Slack = FMath::Max(RootInstance->ProximityCollisionSlack, 0.0f);
+	}
+}
+
+void UTh3CollisionManager::Deinitialize()
+{
+	Cells.Empty();
+	RegisteredBounds.Empty();
+	Upgraded.Empty();
+	Pinned.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UTh3CollisionManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTh3CollisionManager, STATGROUP_Tickables);
+}
+
+FIntVector UTh3CollisionManager::GetCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / Radius), FMath::FloorToInt(Location.Y / Radius), FMath::FloorToInt(Location.Z / Radius));
+}
+
+FBox UTh3CollisionManager::GetBounds(const TWeakObjectPtr<ATh3BuildableSM>& Buildable) const
+{
+	const FBox* Bounds = RegisteredBounds.Find(Buildable);
+	return Bounds ? *Bounds : Buildable->GetCollisionBounds();
+}
+
+/* Calls func for every cell from Min to Max, both included */
+template<typename Func>
+static void ForEachCell(const FIntVector& Min, const FIntVector& Max, Func func)
+{
+	for (int32 X = Min.X; X <= Max.X; X++) {
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++) {
+			for (int32 Z = Min.Z; Z <= Max.Z; Z++) {
+				func(FIntVector(X, Y, Z));
+			}
+		}
+	}
+}
+
+void UTh3CollisionManager::Register(ATh3BuildableSM* Buildable)
+{
+	if (RegisteredBounds.Contains(Buildable)) {
+		return;
+	}
+	const FBox Bounds = Buildable->GetCollisionBounds();
+	RegisteredBounds.Add(Buildable, Bounds);
+	ForEachCell(GetCell(Bounds.Min), GetCell(Bounds.Max), [this, Buildable](const FIntVector& Cell) {
+		Cells.FindOrAdd(Cell).Add(Buildable);
+	});
+	/* Check right away, so a buildable placed next to a player does not wait */
+	TimeUntilCheck = 0.0f;
+}
+
+void UTh3CollisionManager::Unregister(ATh3BuildableSM* Buildable)
+{
+	FBox Bounds;
+	if (RegisteredBounds.RemoveAndCopyValue(Buildable, Bounds)) {
+		ForEachCell(GetCell(Bounds.Min), GetCell(Bounds.Max), [this, Buildable](const FIntVector& Cell) {
+			if (TArray<TWeakObjectPtr<ATh3BuildableSM>>* Bucket = Cells.Find(Cell)) {
+				Bucket->RemoveSwap(Buildable);
+				if (Bucket->IsEmpty()) {
+					Cells.Remove(Cell);
+				}
+			}
+		});
+	}
+	Upgraded.Remove(Buildable);
+	Pinned.Remove(Buildable);
+}
+
+void UTh3CollisionManager::Upgrade(ATh3BuildableSM* Buildable)
+{
+	if (not Upgraded.Contains(Buildable)) {
+		Upgraded.Add(Buildable);
+		Buildable->SetFullCollision(true);
+	}
+}
+
+void UTh3CollisionManager::Pin(ATh3BuildableSM* Buildable)
+{
+	Pinned.Add(Buildable);
+	Upgrade(Buildable);
+}
+
+void UTh3CollisionManager::Unpin(ATh3BuildableSM* Buildable)
+{
+	if (Pinned.Remove(Buildable) > 0) {
+		/* Downgrade it soon if nobody is near */
+		TimeUntilCheck = 0.0f;
+	}
+}
+
+void UTh3CollisionManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeUntilCheck -= DeltaTime;
+	if (TimeUntilCheck > 0.0f or Cells.IsEmpty()) {
+		return;
+	}
+	TimeUntilCheck = CheckInterval;
+
+	/* Clients only have their own player controller, but every player state */
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	if (not GameState) {
+		return;
+	}
+	TArray<FVector> PlayerLocations;
+	for (const APlayerState* PlayerState : GameState->PlayerArray) {
+		if (const APawn* Pawn = PlayerState ? PlayerState->GetPawn() : nullptr) {
+			PlayerLocations.Add(Pawn->GetActorLocation());
+		}
+	}
+	UpdateUpgrades(PlayerLocations);
+}
+
+void UTh3CollisionManager::UpdateUpgrades(const TArray<FVector>& PlayerLocations)
+{
+	const float UpgradeDistSq = FMath::Square(Radius);
+	const float KeepDistSq = FMath::Square(Radius + Slack);
+
+	for (const FVector& Location : PlayerLocations) {
+		const FIntVector Center = GetCell(Location);
+		ForEachCell(Center - FIntVector(1), Center + FIntVector(1), [this, &Location, UpgradeDistSq](const FIntVector& Cell) {
+			const TArray<TWeakObjectPtr<ATh3BuildableSM>>* Bucket = Cells.Find(Cell);
+			if (not Bucket) {
+				return;
+			}
+			for (const TWeakObjectPtr<ATh3BuildableSM>& Weak : *Bucket) {
+				ATh3BuildableSM* Buildable = Weak.Get();
+				if (Buildable and GetBounds(Weak).ComputeSquaredDistanceToPoint(Location) <= UpgradeDistSq) {
+					Upgrade(Buildable);
+				}
+			}
+		});
+	}
+
+	for (auto It = Upgraded.CreateIterator(); It; ++It) {
+		ATh3BuildableSM* Buildable = It->Get();
+		if (not Buildable) {
+			It.RemoveCurrent();
+			continue;
+		}
+		if (Pinned.Contains(*It)) {
+			continue;
+		}
+		const FBox Bounds = GetBounds(*It);
+		const bool bNearby = PlayerLocations.ContainsByPredicate([&Bounds, KeepDistSq](const FVector& Location) {
+			return Bounds.ComputeSquaredDistanceToPoint(Location) <= KeepDistSq;
+		});
+		if (not bNearby) {
+			Buildable->SetFullCollision(false);
+			It.RemoveCurrent();
+		}
+	}
+}
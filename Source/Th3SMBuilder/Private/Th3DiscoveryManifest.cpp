@@ -0,0 +1,192 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3DiscoveryManifest.h"
+#include "Th3SMBuilder.h"
+
+#include "Algo/Transform.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "HAL/PlatformFileManager.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/App.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+static constexpr uint32 MANIFEST_MAGIC = 0x4D443354; /* "T3DM" */
+static constexpr uint32 MANIFEST_VERSION = 1;
+
+FString FTh3DiscoveryManifest::GetManifestPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("Th3SMBuilder") / TEXT("DiscoveryManifest.bin");
+}
+
+FString FTh3DiscoveryManifest::GetMountRoot(const FString& PackageName)
+{
+	const int32 End = PackageName.Find(TEXT("/"), ESearchCase::CaseSensitive, ESearchDir::FromStart, 1);
+	return End == INDEX_NONE ? PackageName : PackageName.Left(End);
+}
+
+uint32 FTh3DiscoveryManifest::HashMountRoot(const FString& MountRoot)
+{
+	uint32 Hash = GetTypeHash(MountRoot);
+	const TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(MountRoot.RightChop(1));
+	if (Plugin) {
+		const FPluginDescriptor& Descriptor = Plugin->GetDescriptor();
+		Hash = HashCombine(Hash, GetTypeHash(Descriptor.Version));
+		Hash = HashCombine(Hash, GetTypeHash(Descriptor.VersionName));
+		Hash = HashCombine(Hash, GetTypeHash(IFileManager::Get().GetTimeStamp(*Plugin->GetDescriptorFileName())));
+	} else {
+		/* Game and engine content only changes when the game gets updated */
+		Hash = HashCombine(Hash, FCrc::StrCrc32(FApp::GetBuildVersion()));
+		Hash = HashCombine(Hash, GetTypeHash(FEngineVersion::Current().GetChangelist()));
+	}
+	return Hash;
+}
+
+FArchive& operator<<(FArchive& Ar, FTh3DiscoveryManifest::FRootEntry& Entry)
+{
+	Ar << Entry.ContentHash;
+	TArray<FString> AssetPaths;
+	if (Ar.IsSaving()) {
+		Algo::Transform(Entry.Assets, AssetPaths, [](const FSoftObjectPath& Path) { return Path.ToString(); });
+	}
+	Ar << AssetPaths;
+	if (Ar.IsLoading()) {
+		Entry.Assets.Reset(AssetPaths.Num());
+		Algo::Transform(AssetPaths, Entry.Assets, [](const FString& Path) { return FSoftObjectPath(Path); });
+	}
+	return Ar;
+}
+
+bool FTh3DiscoveryManifest::Load()
+{
+	const FString ManifestPath = GetManifestPath();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (not PlatformFile.FileExists(*ManifestPath)) {
+		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("No discovery manifest at %s"), *ManifestPath);
+		return false;
+	}
+
+	/* Map the file if the platform allows it, it is only read once */
+	TArray<uint8> FileData;
+	TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*ManifestPath));
+	TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile ? MappedFile->MapRegion() : nullptr);
+	TArrayView<const uint8> View;
+	if (MappedRegion) {
+		View = TArrayView<const uint8>(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize());
+	} else if (FFileHelper::LoadFileToArray(FileData, *ManifestPath)) {
+		View = FileData;
+	} else {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not read discovery manifest %s"), *ManifestPath);
+		return false;
+	}
+
+	FMemoryReaderView Reader(View);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Reader << Magic;
+	Reader << Version;
+	if (Magic != MANIFEST_MAGIC or Version != MANIFEST_VERSION) {
+		UE_LOG(LogTh3SMBuilderCpp, Warning, TEXT("Ignoring discovery manifest with version %u"), Version);
+		return false;
+	}
+	Reader << Classes;
+	if (Reader.IsError()) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Discovery manifest %s is corrupted"), *ManifestPath);
+		Classes.Empty();
+		return false;
+	}
+	bDirty = false;
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Loaded discovery manifest with %d classes"), Classes.Num());
+	return true;
+}
+
+bool FTh3DiscoveryManifest::SaveIfDirty()
+{
+	if (not bDirty) {
+		return true;
+	}
+	TArray<uint8> FileData;
+	FMemoryWriter Writer(FileData);
+	uint32 Magic = MANIFEST_MAGIC;
+	uint32 Version = MANIFEST_VERSION;
+	Writer << Magic;
+	Writer << Version;
+	Writer << Classes;
+
+	const FString ManifestPath = GetManifestPath();
+	if (not FFileHelper::SaveArrayToFile(FileData, *ManifestPath)) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not write discovery manifest %s"), *ManifestPath);
+		return false;
+	}
+	bDirty = false;
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Saved discovery manifest (%d bytes)"), FileData.Num());
+	return true;
+}
+
+void FTh3DiscoveryManifest::Discover(UClass* BaseClass, TArray<FSoftObjectPath>& out_Paths)
+{
+	TMap<FString, FRootEntry>& Roots = Classes.FindOrAdd(BaseClass->GetClassPathName().ToString());
+
+	TArray<FString> MountRoots;
+	FPackageName::QueryRootContentPaths(MountRoots, false, false, true);
+
+	/* Forget about roots that are no longer mounted */
+	for (auto It = Roots.CreateIterator(); It; ++It) {
+		if (not MountRoots.Contains(It->Key)) {
+			It.RemoveCurrent();
+			bDirty = true;
+		}
+	}
+
+	TArray<FName> StaleRoots;
+	for (const FString& MountRoot : MountRoots) {
+		const uint32 ContentHash = HashMountRoot(MountRoot);
+		const FRootEntry* Cached = Roots.Find(MountRoot);
+		if (Cached and Cached->ContentHash == ContentHash) {
+			continue;
+		}
+		FRootEntry& Entry = Roots.FindOrAdd(MountRoot);
+		Entry.ContentHash = ContentHash;
+		Entry.Assets.Reset();
+		StaleRoots.Add(FName(*MountRoot));
+	}
+
+	if (not StaleRoots.IsEmpty()) {
+		FARFilter Filter;
+		Filter.ClassPaths.Add(BaseClass->GetClassPathName());
+		Filter.bRecursiveClasses = true;
+		/* On a cold start everything is stale, and a plain class query is cheaper */
+		if (StaleRoots.Num() < MountRoots.Num()) {
+			Filter.PackagePaths = StaleRoots;
+			Filter.bRecursivePaths = true;
+		}
+		TArray<FAssetData> AssetData;
+		IAssetRegistry::Get()->GetAssets(Filter, AssetData);
+		for (const FAssetData& Asset : AssetData) {
+			if (FRootEntry* Entry = Roots.Find(GetMountRoot(Asset.PackageName.ToString()))) {
+				Entry->Assets.Add(Asset.GetSoftObjectPath());
+			}
+		}
+		bDirty = true;
+		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Rediscovered '%s' in %d out of %d mount roots"), *BaseClass->GetName(), StaleRoots.Num(), MountRoots.Num());
+	}
+
+	for (const FString& MountRoot : MountRoots) {
+		out_Paths.Append(Roots.FindChecked(MountRoot).Assets);
+	}
+}
+
+SIZE_T FTh3DiscoveryManifest::GetAllocatedSize() const
+{
+	SIZE_T Size = Classes.GetAllocatedSize();
+	for (const TPair<FString, TMap<FString, FRootEntry>>& Class : Classes) {
+		Size += Class.Key.GetAllocatedSize() + Class.Value.GetAllocatedSize();
+		for (const TPair<FString, FRootEntry>& Root : Class.Value) {
+			Size += Root.Key.GetAllocatedSize() + Root.Value.Assets.GetAllocatedSize();
+		}
+	}
+	return Size;
+}
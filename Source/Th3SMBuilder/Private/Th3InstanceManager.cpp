@@ -0,0 +1,125 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3InstanceManager.h"
+#include "Th3SMBuilder.h"
+
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+
+UTh3InstanceManager* UTh3InstanceManager::Get(const UObject* WorldContext)
+{
+	const UWorld* World = WorldContext ? WorldContext->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UTh3InstanceManager>() : nullptr;
+}
+
+bool UTh3InstanceManager::ShouldCreateSubsystem(UObject* Outer) const
+{
+	/* Nothing gets drawn on a dedicated server */
+	return not IsRunningDedicatedServer() and Super::ShouldCreateSubsystem(Outer);
+}
+
+void UTh3InstanceManager::Deinitialize()
+{
+	Handles.Empty();
+	GroupIds.Empty();
+	Groups.Empty();
+	if (IsValid(Host)) {
+		Host->Destroy();
+	}
+	Host = nullptr;
+	Super::Deinitialize();
+}
+
+UHierarchicalInstancedStaticMeshComponent* UTh3InstanceManager::MakeComponent(const FGroupKey& Key)
+{
+	if (not IsValid(Host)) {
+		FActorSpawnParameters Params;
+		Params.Name = TEXT("Th3InstanceHost");
+		Params.NameMode = FActorSpawnParameters::ESpawnActorNameMode::Requested;
+		Params.ObjectFlags = RF_Transient;
+		Host = GetWorld()->SpawnActor<AActor>(Params);
+		if (not Host) {
+			UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not spawn instance host actor"));
+			return nullptr;
+		}
+		USceneComponent* Root = NewObject<USceneComponent>(Host, TEXT("Root"));
+		Root->SetMobility(EComponentMobility::Static);
+		Host->SetRootComponent(Root);
+		Root->RegisterComponent();
+	}
+	UHierarchicalInstancedStaticMeshComponent* Component = NewObject<UHierarchicalInstancedStaticMeshComponent>(Host);
+	Component->SetMobility(EComponentMobility::Static);
+	Component->SetupAttachment(Host->GetRootComponent());
+	Component->SetStaticMesh(Key.Mesh);
+	Component->SetForceDisableNanite(true);
+	Component->bSupportRemoveAtSwap = true;
+	/* Buildables keep their own collision */
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	for (int32 Index = 0; Index < Key.Materials.Num(); Index++) {
+		Component->SetMaterial(Index, Key.Materials[Index]);
+	}
+	Component->RegisterComponent();
+	Host->AddInstanceComponent(Component);
+	return Component;
+}
+
+bool UTh3InstanceManager::AddInstance(AActor* Buildable, UStaticMesh* Mesh, const TArray<UMaterialInterface*>& Materials, const FTransform& Transform)
+{
+	if (not Buildable or not Mesh) {
+		return false;
+	}
+	RemoveInstance(Buildable);
+
+	FGroupKey Key{ Mesh, Materials };
+	int32 GroupId = INDEX_NONE;
+	if (const int32* Found = GroupIds.Find(Key)) {
+		GroupId = *Found;
+	} else {
+		UHierarchicalInstancedStaticMeshComponent* Component = MakeComponent(Key);
+		if (not Component) {
+			return false;
+		}
+		GroupId = Groups.Add(FGroup{ Key, Component });
+		GroupIds.Add(MoveTemp(Key), GroupId);
+	}
+
+	FGroup& Group = Groups[GroupId];
+	const int32 Instance = Group.Component->AddInstance(Transform, true);
+	check(Instance == Group.Owners.Num());
+	Group.Owners.Add(Buildable);
+	Handles.Add(Buildable, FHandle{ GroupId, Instance });
+	return true;
+}
+
+bool UTh3InstanceManager::RemoveInstance(AActor* Buildable)
+{
+	FHandle Handle;
+	if (not Handles.RemoveAndCopyValue(Buildable, Handle)) {
+		return false;
+	}
+	FGroup& Group = Groups[Handle.Group];
+	/* The last instance is swapped into the hole, mirror that */
+	Group.Component->RemoveInstance(Handle.Instance);
+	Group.Owners.RemoveAtSwap(Handle.Instance);
+	if (Group.Owners.IsValidIndex(Handle.Instance)) {
+		Handles[Group.Owners[Handle.Instance]].Instance = Handle.Instance;
+	}
+
+	if (Group.Owners.IsEmpty()) {
+		Group.Component->DestroyComponent();
+		GroupIds.Remove(Group.Key);
+		Groups.RemoveAt(Handle.Group);
+	}
+	return true;
+}
+
+bool UTh3InstanceManager::FindInstance(AActor* Buildable, UHierarchicalInstancedStaticMeshComponent*& out_Component, int32& out_Instance) const
+{
+	const FHandle* Handle = Handles.Find(Buildable);
+	if (not Handle) {
+		return false;
+	}
+	out_Component = Groups[Handle->Group].Component;
+	out_Instance = Handle->Instance;
+	return true;
+}
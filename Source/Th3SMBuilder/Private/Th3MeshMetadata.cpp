@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3MeshMetadata.h"
+#include "Th3SMBuilder.h"
+#include "Th3SMBuilderStats.h"
+
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/StaticMesh.h"
+
+/* Tags written by UStaticMesh::GetAssetRegistryTags */
+static const FName NAME_Triangles(TEXT("Triangles"));
+static const FName NAME_Vertices(TEXT("Vertices"));
+static const FName NAME_LODs(TEXT("LODs"));
+static const FName NAME_Materials(TEXT("Materials"));
+static const FName NAME_ApproxSize(TEXT("ApproxSize"));
+static const FName NAME_NaniteEnabled(TEXT("NaniteEnabled"));
+
+/* Formatted as "XxYxZ" */
+static FVector3f ParseApproxSize(const FString& Value)
+{
+	TArray<FString> Parts;
+	if (Value.ParseIntoArray(Parts, TEXT("x")) != 3) {
+		return FVector3f::ZeroVector;
+	}
+	return FVector3f(FCString::Atof(*Parts[0]), FCString::Atof(*Parts[1]), FCString::Atof(*Parts[2]));
+}
+
+void FTh3MeshMetadata::Build(TConstArrayView<TSoftObjectPtr<UStaticMesh>> Meshes)
+{
+	const int32 Count = Meshes.Num();
+	Triangles.SetNumZeroed(Count);
+	Vertices.SetNumZeroed(Count);
+	NumLODs.SetNumZeroed(Count);
+	NumMaterials.SetNumZeroed(Count);
+	ApproxSizes.SetNumZeroed(Count);
+	Nanite.Init(false, Count);
+	Valid.Init(false, Count);
+
+	IAssetRegistry& AssetRegistry = *IAssetRegistry::Get();
+	int32 NumValid = 0;
+	for (int32 MeshId = 0; MeshId < Count; MeshId++) {
+		const FAssetData Asset = AssetRegistry.GetAssetByObjectPath(Meshes[MeshId].ToSoftObjectPath());
+		if (not Asset.IsValid() or not Asset.GetTagValue(NAME_Triangles, Triangles[MeshId])) {
+			continue;
+		}
+		int32 Value = 0;
+		Asset.GetTagValue(NAME_Vertices, Vertices[MeshId]);
+		if (Asset.GetTagValue(NAME_LODs, Value)) {
+			NumLODs[MeshId] = static_cast<uint8>(FMath::Clamp(Value, 0, 255));
+		}
+		if (Asset.GetTagValue(NAME_Materials, Value)) {
+			NumMaterials[MeshId] = static_cast<uint8>(FMath::Clamp(Value, 0, 255));
+		}
+		FString ApproxSize;
+		if (Asset.GetTagValue(NAME_ApproxSize, ApproxSize)) {
+			ApproxSizes[MeshId] = ParseApproxSize(ApproxSize);
+		}
+		bool bNanite = false;
+		if (Asset.GetTagValue(NAME_NaniteEnabled, bNanite)) {
+			Nanite[MeshId] = bNanite;
+		}
+		Valid[MeshId] = true;
+		NumValid++;
+	}
+	SET_MEMORY_STAT(STAT_Th3_MeshMetadataMemory, GetAllocatedSize());
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Read mesh metadata for %d out of %d meshes"), NumValid, Count);
+}
+
+FTh3MeshInfo FTh3MeshMetadata::Get(const int32 MeshId) const
+{
+	FTh3MeshInfo Info;
+	if (not Valid.IsValidIndex(MeshId) or not Valid[MeshId]) {
+		return Info;
+	}
+	Info.bValid = true;
+	Info.Triangles = Triangles[MeshId];
+	Info.Vertices = Vertices[MeshId];
+	Info.NumLODs = NumLODs[MeshId];
+	Info.NumMaterials = NumMaterials[MeshId];
+	Info.ApproxSize = FVector(ApproxSizes[MeshId]);
+	Info.bNanite = Nanite[MeshId];
+	return Info;
+}
+
+SIZE_T FTh3MeshMetadata::GetAllocatedSize() const
+{
+	return Triangles.GetAllocatedSize() + Vertices.GetAllocatedSize()
+		+ NumLODs.GetAllocatedSize() + NumMaterials.GetAllocatedSize()
+		+ ApproxSizes.GetAllocatedSize() + Nanite.GetAllocatedSize() + Valid.GetAllocatedSize();
+}
@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3MeshResidency.h"
+#include "Th3SMBuilder.h"
+#include "Th3SMBuilderRootInstance.h"
+#include "Th3SMBuilderStats.h"
+
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+
+UTh3MeshResidency* UTh3MeshResidency::Get(UObject* WorldContext)
+{
+	UWorld* World = WorldContext ? WorldContext->GetWorld() : nullptr;
+	if (not World) {
+		return nullptr;
+	}
+	const UTh3SMBuilderRootInstance* RootInstance = UTh3SMBuilderRootInstance::Get(World);
+	return RootInstance ? RootInstance->GetMeshResidency() : nullptr;
+}
+
+int32 UTh3MeshResidency::FindOrLoad(const TSoftObjectPtr<UStaticMesh>& MeshPtr)
+{
+	const FSoftObjectPath& Path = MeshPtr.ToSoftObjectPath();
+	if (const int32* Found = Slots.Find(Path)) {
+		return *Found;
+	}
+	UStaticMesh* Mesh = MeshPtr.LoadSynchronous();
+	if (not Mesh) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not load mesh %s"), *Path.ToString());
+		return INDEX_NONE;
+	}
+	int32 Slot = INDEX_NONE;
+	if (FreeSlots.IsEmpty()) {
+		Slot = Entries.AddDefaulted();
+		Meshes.Add(Mesh);
+	} else {
+		Slot = FreeSlots.Pop();
+		Entries[Slot] = FEntry();
+		Meshes[Slot] = Mesh;
+	}
+	FEntry& Entry = Entries[Slot];
+	Entry.Path = Path;
+	Entry.Size = Mesh->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+	Slots.Add(Path, Slot);
+	ResidentBytes += Entry.Size;
+	SET_MEMORY_STAT(STAT_Th3_ResidentMeshMemory, ResidentBytes);
+	return Slot;
+}
+
+UStaticMesh* UTh3MeshResidency::Acquire(const TSoftObjectPtr<UStaticMesh>& MeshPtr)
+{
+	const int32 Slot = FindOrLoad(MeshPtr);
+	if (Slot == INDEX_NONE) {
+		return nullptr;
+	}
+	if (Entries[Slot].RefCount++ == 0) {
+		Unlink(Slot);
+	}
+	return Meshes[Slot];
+}
+
+void UTh3MeshResidency::Release(const TSoftObjectPtr<UStaticMesh>& MeshPtr)
+{
+	const int32* Slot = Slots.Find(MeshPtr.ToSoftObjectPath());
+	if (not Slot or Entries[*Slot].RefCount <= 0) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Releasing mesh %s, which was not acquired"), *MeshPtr.ToString());
+		return;
+	}
+	if (--Entries[*Slot].RefCount == 0) {
+		Link(*Slot);
+		Trim();
+	}
+}
+
+UStaticMesh* UTh3MeshResidency::Touch(const TSoftObjectPtr<UStaticMesh>& MeshPtr)
+{
+	const int32 Slot = FindOrLoad(MeshPtr);
+	if (Slot == INDEX_NONE) {
+		return nullptr;
+	}
+	UStaticMesh* Mesh = Meshes[Slot];
+	if (Entries[Slot].RefCount == 0) {
+		/* Out of the list while trimming, as the caller is about to store the mesh */
+		Unlink(Slot);
+		Trim();
+		/* Back in at the most recently used end */
+		Link(Slot);
+	}
+	return Mesh;
+}
+
+void UTh3MeshResidency::Link(const int32 Slot)
+{
+	FEntry& Entry = Entries[Slot];
+	Entry.Prev = Tail;
+	Entry.Next = INDEX_NONE;
+	if (Tail != INDEX_NONE) {
+		Entries[Tail].Next = Slot;
+	} else {
+		Head = Slot;
+	}
+	Tail = Slot;
+}
+
+void UTh3MeshResidency::Unlink(const int32 Slot)
+{
+	FEntry& Entry = Entries[Slot];
+	if (Entry.Prev == INDEX_NONE and Head != Slot) {
+		/* Not in the list */
+		return;
+	}
+	if (Entry.Prev != INDEX_NONE) {
+		Entries[Entry.Prev].Next = Entry.Next;
+	} else {
+		Head = Entry.Next;
+	}
+	if (Entry.Next != INDEX_NONE) {
+		Entries[Entry.Next].Prev = Entry.Prev;
+	} else {
+		Tail = Entry.Prev;
+	}
+	Entry.Prev = INDEX_NONE;
+	Entry.Next = INDEX_NONE;
+}
+
+void UTh3MeshResidency::Evict(const int32 Slot)
+{
+	Unlink(Slot);
+	const FSoftObjectPath Path = Entries[Slot].Path;
+	ResidentBytes -= Entries[Slot].Size;
+	Slots.Remove(Path);
+	Entries[Slot] = FEntry();
+	Meshes[Slot] = nullptr;
+	FreeSlots.Add(Slot);
+	OnMeshEvicted.Broadcast(Path);
+}
+
+void UTh3MeshResidency::Trim()
+{
+	if (BudgetBytes <= 0) {
+		return;
+	}
+	int32 NumEvicted = 0;
+	while (ResidentBytes > BudgetBytes and Head != INDEX_NONE) {
+		Evict(Head);
+		NumEvicted++;
+	}
+	if (NumEvicted > 0) {
+		SET_MEMORY_STAT(STAT_Th3_ResidentMeshMemory, ResidentBytes);
+		UE_LOG(LogTh3SMBuilderCpp, Verbose, TEXT("Evicted %d meshes, %lld bytes still resident"), NumEvicted, ResidentBytes);
+	}
+}
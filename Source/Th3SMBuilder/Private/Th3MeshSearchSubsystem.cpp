@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3MeshSearchSubsystem.h"
+#include "Th3SMBuilder.h"
+#include "Th3SMBuilderRootInstance.h"
+#include "Th3SMBuilderStats.h"
+#include "Th3BuildableSM.h"
+
+#include "Algo/Sort.h"
+#include "Algo/Transform.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+
+UTh3MeshSearchSubsystem* UTh3MeshSearchSubsystem::Get(UObject* WorldContext)
+{
+	const UWorld* World = WorldContext ? WorldContext->GetWorld() : nullptr;
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<UTh3MeshSearchSubsystem>() : nullptr;
+}
+
+void UTh3MeshSearchSubsystem::Deinitialize()
+{
+	Descriptors.Empty();
+	Trie.Reset();
+	bIndexBuilt = false;
+	Super::Deinitialize();
+}
+
+bool UTh3MeshSearchSubsystem::IsReady() const
+{
+	const UTh3SMBuilderRootInstance* RootInstance = UTh3SMBuilderRootInstance::Get(GetGameInstance());
+	return RootInstance and RootInstance->bBuildablesReady;
+}
+
+bool UTh3MeshSearchSubsystem::BuildIndex()
+{
+	if (bIndexBuilt) {
+		return true;
+	}
+	const UTh3SMBuilderRootInstance* RootInstance = UTh3SMBuilderRootInstance::Get(GetGameInstance());
+	if (not RootInstance or not RootInstance->bBuildablesReady) {
+		return false;
+	}
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_BuildMeshSearchIndex);
+
+	struct FDoc
+	{
+		TSubclassOf<UFGBuildingDescriptor> Descriptor;
+		const ATh3BuildableSM* Buildable;
+	};
+	TArray<FDoc> Docs;
+	Docs.Reserve(RootInstance->RecipesByDescriptor.Num());
+	for (const TPair<TSubclassOf<UFGBuildingDescriptor>, TSubclassOf<UFGRecipe>>& Pair : RootInstance->RecipesByDescriptor) {
+		const TSubclassOf<AFGBuildable> BuildableClass = UFGBuildingDescriptor::GetBuildableClass(Pair.Key);
+		if (const ATh3BuildableSM* Buildable = Cast<ATh3BuildableSM>(BuildableClass.GetDefaultObject())) {
+			Docs.Add({ Pair.Key, Buildable });
+		}
+	}
+	/* Same order as the build menu */
+	Algo::SortBy(Docs, [](const FDoc& Doc) { return Doc.Buildable->GetMeshId(); });
+
+	Descriptors.Reset(Docs.Num());
+	Trie.Reset();
+	TArray<FString> Tokens;
+	for (int32 DocId = 0; DocId < Docs.Num(); DocId++) {
+		Descriptors.Add(Docs[DocId].Descriptor);
+		Tokens.Reset();
+		FTh3TokenTrie::Tokenize(Docs[DocId].Buildable->GetMeshPtr().ToString(), Tokens);
+		for (const FSoftObjectPath& Alias : Docs[DocId].Buildable->GetMeshAliases()) {
+			FTh3TokenTrie::Tokenize(Alias.ToString(), Tokens);
+		}
+		for (const FString& Token : Tokens) {
+			Trie.Add(DocId, Token);
+		}
+	}
+	Trie.Build();
+	bIndexBuilt = true;
+	SET_MEMORY_STAT(STAT_Th3_MeshSearchIndexMemory, Trie.GetAllocatedSize() + Descriptors.GetAllocatedSize());
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Indexed %d meshes with %d distinct tokens for search"), Descriptors.Num(), Trie.NumTokens());
+	return true;
+}
+
+int32 UTh3MeshSearchSubsystem::SearchMeshes(TArray<TSubclassOf<UFGBuildingDescriptor>>& out_Descriptors, const FString& Query, int32 PageIndex, int32 PageSize)
+{
+	out_Descriptors.Reset();
+	if (not BuildIndex()) {
+		return 0;
+	}
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_MeshSearch);
+	TArray<int32> DocIds;
+	const int32 NumMatches = Trie.Search(Query, Descriptors.Num(), PageIndex, PageSize, DocIds);
+	Algo::Transform(DocIds, out_Descriptors, [this](const int32 DocId) { return Descriptors[DocId]; });
+	return NumMatches;
+}
@@ -0,0 +1,130 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3PathMatcher.h"
+#include "Th3SMBuilder.h"
+
+void FTh3PathMatcher::Compile(TConstArrayView<FString> IncludeRules, TConstArrayView<FString> ExcludeRules)
+{
+	Nodes.Reset();
+	Nodes.AddDefaulted();
+	bHasIncludes = not IncludeRules.IsEmpty();
+	for (const FString& Rule : IncludeRules) {
+		AddRule(Rule, ERule::Include);
+	}
+	for (const FString& Rule : ExcludeRules) {
+		AddRule(Rule, ERule::Exclude);
+	}
+}
+
+void FTh3PathMatcher::AddRule(const FString& Rule, const ERule Kind)
+{
+	TArray<FString> Segments;
+	Rule.ParseIntoArray(Segments, TEXT("/"));
+	if (Segments.IsEmpty()) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Ignoring empty path rule '%s'"), *Rule);
+		return;
+	}
+	int32 Node = 0;
+	for (const FString& Segment : Segments) {
+		const bool bPattern = Segment.Contains(TEXT("*"));
+		int32 Child = INDEX_NONE;
+		if (bPattern) {
+			if (const TPair<FString, int32>* Found = Nodes[Node].Patterns.FindByPredicate([&Segment](const TPair<FString, int32>& Pattern) { return Pattern.Key.Equals(Segment, ESearchCase::IgnoreCase); })) {
+				Child = Found->Value;
+			}
+		} else if (const int32* Found = Nodes[Node].Children.Find(FName(*Segment))) {
+			Child = *Found;
+		}
+		if (Child == INDEX_NONE) {
+			/* Adding a node may move the others, only index into Nodes afterwards */
+			Child = Nodes.AddDefaulted();
+			if (bPattern) {
+				Nodes[Node].Patterns.Emplace(Segment, Child);
+			} else {
+				Nodes[Node].Children.Add(FName(*Segment), Child);
+			}
+		}
+		Node = Child;
+	}
+	if (Nodes[Node].Rule != ERule::Exclude) {
+		Nodes[Node].Rule = Kind;
+	}
+}
+
+bool FTh3PathMatcher::MatchesPattern(const FStringView Pattern, const FStringView Text)
+{
+	/* Backtracks to the last "*" only, which is enough when "*" cannot match across folders */
+	int32 P = 0;
+	int32 T = 0;
+	int32 StarP = INDEX_NONE;
+	int32 StarT = 0;
+	while (T < Text.Len()) {
+		if (P < Pattern.Len() and Pattern[P] == TEXT('*')) {
+			StarP = P++;
+			StarT = T;
+		} else if (P < Pattern.Len() and FChar::ToLower(Pattern[P]) == FChar::ToLower(Text[T])) {
+			P++;
+			T++;
+		} else if (StarP != INDEX_NONE) {
+			P = StarP + 1;
+			T = ++StarT;
+		} else {
+			return false;
+		}
+	}
+	while (P < Pattern.Len() and Pattern[P] == TEXT('*')) {
+		P++;
+	}
+	return P == Pattern.Len();
+}
+
+void FTh3PathMatcher::Match(const int32 Node, TConstArrayView<FSegment> Segments, const int32 Depth, int32& out_Depth, ERule& out_Rule) const
+{
+	const FNode& Current = Nodes[Node];
+	if (Current.Rule != ERule::None and (Depth > out_Depth or (Depth == out_Depth and Current.Rule == ERule::Exclude))) {
+		out_Depth = Depth;
+		out_Rule = Current.Rule;
+	}
+	if (Segments.IsEmpty()) {
+		return;
+	}
+	if (const int32* Child = Current.Children.Find(Segments[0].Name)) {
+		Match(*Child, Segments.RightChop(1), Depth + 1, out_Depth, out_Rule);
+	}
+	for (const TPair<FString, int32>& Pattern : Current.Patterns) {
+		if (MatchesPattern(Pattern.Key, Segments[0].Text)) {
+			Match(Pattern.Value, Segments.RightChop(1), Depth + 1, out_Depth, out_Rule);
+		}
+	}
+}
+
+bool FTh3PathMatcher::IsIncluded(const FName PackageName) const
+{
+	if (Nodes.Num() <= 1) {
+		return true;
+	}
+	TStringBuilder<NAME_SIZE> Path;
+	PackageName.AppendString(Path);
+
+	/* Folders nobody ever named can only match rules with a "*", they are left as NAME_None */
+	TArray<FSegment, TInlineAllocator<16>> Segments;
+	FStringView Rest = Path.ToView();
+	while (not Rest.IsEmpty()) {
+		int32 Slash = INDEX_NONE;
+		if (not Rest.FindChar(TEXT('/'), Slash)) {
+			Slash = Rest.Len();
+		}
+		if (Slash > 0) {
+			Segments.Add(FSegment{ FName(Rest.Left(Slash), FNAME_Find), Rest.Left(Slash) });
+		}
+		Rest.RightChopInline(Slash + 1);
+	}
+
+	int32 Depth = -1;
+	ERule Rule = ERule::None;
+	Match(0, Segments, 0, Depth, Rule);
+	if (Rule == ERule::None) {
+		return not bHasIncludes;
+	}
+	return Rule == ERule::Include;
+}
@@ -1,7 +1,31 @@
 /* SPDX-License-Identifier: MPL-2.0 */
 
 #include "Th3SMBuilder.h"
+#include "Th3SMBuilderStats.h"
 
 DEFINE_LOG_CATEGORY(LogTh3SMBuilderCpp);
 
+DEFINE_STAT(STAT_Th3_Discovery);
+DEFINE_STAT(STAT_Th3_GenerateClass);
+DEFINE_STAT(STAT_Th3_MakeBuildable);
+DEFINE_STAT(STAT_Th3_MakeDescriptor);
+DEFINE_STAT(STAT_Th3_MakeRecipe);
+DEFINE_STAT(STAT_Th3_SchematicUnlock);
+DEFINE_STAT(STAT_Th3_RenderThumbnail);
+DEFINE_STAT(STAT_Th3_BuildSearchIndex);
+DEFINE_STAT(STAT_Th3_Search);
+DEFINE_STAT(STAT_Th3_BuildMeshSearchIndex);
+DEFINE_STAT(STAT_Th3_MeshSearch);
+DEFINE_STAT(STAT_Th3_NumBuildables);
+DEFINE_STAT(STAT_Th3_NumMeshAliases);
+DEFINE_STAT(STAT_Th3_NumThumbnailsRendered);
+DEFINE_STAT(STAT_Th3_NumThumbnailsCached);
+DEFINE_STAT(STAT_Th3_DiscoveryManifestMemory);
+DEFINE_STAT(STAT_Th3_MeshMetadataMemory);
+DEFINE_STAT(STAT_Th3_ResidentMeshMemory);
+DEFINE_STAT(STAT_Th3_SearchIndexMemory);
+DEFINE_STAT(STAT_Th3_MeshSearchIndexMemory);
+
+UE_TRACE_CHANNEL_DEFINE(Th3SMBuilderChannel);
+
 IMPLEMENT_MODULE(FTh3SMBuilderModule, Th3SMBuilder)
\ No newline at end of file
@@ -1,7 +1,13 @@
 /* SPDX-License-Identifier: MPL-2.0 */
 
 #include "Th3SMBuilderBPFL.h"
+#include "Th3Utilities.h"
+#include "Th3SMBuilderRootInstance.h"
+#include "Th3SMBuilderRCO.h"
+#include "Th3BuildableSM.h"
 #include "Algo/AllOf.h"
+#include "Algo/Sort.h"
+#include "Algo/Transform.h"
 
 void UTh3SMBuilderBPFL::SplitIntoWords(TArray<FString>& out_SearchWords, const FString& SearchQuery)
 {
@@ -10,5 +16,44 @@ void UTh3SMBuilderBPFL::SplitIntoWords(TArray<FString>& out_SearchWords, const F
 
 bool UTh3SMBuilderBPFL::ContainsAllWords(const FString& Str, const TArray<FString>& SearchWords)
 {
-	return Algo::AllOf(SearchWords, [Str](const FString& Word) { return Str.Contains(Word); });
+	return Algo::AllOf(SearchWords, [&Str](const FString& Word) { return Str.Contains(Word); });
+}
+
+void UTh3SMBuilderBPFL::FindAllContainingWords(TArray<int32>& out_Indices, const TArray<FString>& Candidates, const TArray<FString>& SearchWords)
+{
+	TArray<FString> LowerWords;
+	Algo::Transform(SearchWords, LowerWords, [](const FString& Word) { return Word.ToLower(); });
+	/* Longer words match less often, so they reject candidates sooner */
+	Algo::Sort(LowerWords, [](const FString& A, const FString& B) { return A.Len() > B.Len(); });
+	for (int32 Index = 0; Index < Candidates.Num(); Index++) {
+		const FString& Candidate = Candidates[Index];
+		if (Algo::AllOf(LowerWords, [&Candidate](const FString& Word) { return Th3Utilities::ContainsLowerAscii(Candidate, Word); })) {
+			out_Indices.Add(Index);
+		}
+	}
+}
+
+void UTh3SMBuilderBPFL::RequestMeshRecipe(UObject* WorldContext, TSubclassOf<UFGBuildingDescriptor> Descriptor)
+{
+	const UTh3SMBuilderRootInstance* RootInstance = UTh3SMBuilderRootInstance::Get(WorldContext);
+	if (not RootInstance or not RootInstance->bLazyRecipeUnlock) {
+		/* Everything was unlocked up front */
+		return;
+	}
+	const TSubclassOf<UFGRecipe> Recipe = RootInstance->GetRecipeFor(Descriptor);
+	if (not Recipe) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("No generated recipe for %s"), *Th3::GetPathSafe(Descriptor));
+		return;
+	}
+	UTh3SMBuilderRCO::UnlockRecipe(WorldContext, Recipe);
+}
+
+FTh3MeshInfo UTh3SMBuilderBPFL::GetMeshInfoFor(UObject* WorldContext, TSubclassOf<UFGBuildingDescriptor> Descriptor)
+{
+	const UTh3SMBuilderRootInstance* RootInstance = UTh3SMBuilderRootInstance::Get(WorldContext);
+	const ATh3BuildableSM* Buildable = Descriptor ? Cast<ATh3BuildableSM>(UFGBuildingDescriptor::GetBuildableClass(Descriptor).GetDefaultObject()) : nullptr;
+	if (not RootInstance or not Buildable) {
+		return FTh3MeshInfo();
+	}
+	return RootInstance->GetMeshInfo(Buildable->GetMeshId());
 }
@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3SMBuilderRCO.h"
+#include "Th3SMBuilder.h"
+#include "Th3SMBuilderRootInstance.h"
+#include "Th3BuildableSM.h"
+
+#include "FGPlayerController.h"
+#include "FGRecipeManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Net/UnrealNetwork.h"
+
+void UTh3SMBuilderRCO::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(UTh3SMBuilderRCO, bDummy);
+}
+
+void UTh3SMBuilderRCO::UnlockRecipe(UObject* WorldContext, TSubclassOf<UFGRecipe> Recipe)
+{
+	UWorld* World = WorldContext ? WorldContext->GetWorld() : nullptr;
+	if (not World or not Recipe) {
+		return;
+	}
+	if (World->GetNetMode() != NM_Client) {
+		GrantRecipe(World, Recipe);
+		return;
+	}
+	AFGPlayerController* Controller = Cast<AFGPlayerController>(UGameplayStatics::GetPlayerController(World, 0));
+	UTh3SMBuilderRCO* RCO = Controller ? Controller->GetRemoteCallObjectOfClass<UTh3SMBuilderRCO>() : nullptr;
+	if (not RCO) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("No remote call object to unlock %s"), *Th3::GetPathSafe(Recipe));
+		return;
+	}
+	RCO->Server_UnlockRecipe(Recipe);
+}
+
+void UTh3SMBuilderRCO::Server_UnlockRecipe_Implementation(TSubclassOf<UFGRecipe> Recipe)
+{
+	GrantRecipe(GetWorld(), Recipe);
+}
+
+void UTh3SMBuilderRCO::SetBuildableMaterial(ATh3BuildableSM* Buildable, const int32 Index, UMaterialInterface* Material)
+{
+	UWorld* World = Buildable ? Buildable->GetWorld() : nullptr;
+	if (not World) {
+		return;
+	}
+	AFGPlayerController* Controller = Cast<AFGPlayerController>(UGameplayStatics::GetPlayerController(World, 0));
+	UTh3SMBuilderRCO* RCO = Controller ? Controller->GetRemoteCallObjectOfClass<UTh3SMBuilderRCO>() : nullptr;
+	if (not RCO) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("No remote call object to set material of %s"), *Th3::GetPathSafe(Buildable));
+		return;
+	}
+	RCO->Server_SetBuildableMaterial(Buildable, Index, FSoftObjectPath(Material));
+}
+
+void UTh3SMBuilderRCO::Server_SetBuildableMaterial_Implementation(ATh3BuildableSM* Buildable, int32 Index, const FSoftObjectPath& Material)
+{
+	if (not IsValid(Buildable) or Index < 0 or Index >= Buildable->GetNumMaterialSlots()) {
+		UE_LOG(LogTh3SMBuilderCpp, Warning, TEXT("Refusing to set material %d of %s"), Index, *Th3::GetPathSafe(Buildable));
+		return;
+	}
+	/* Dedicated servers with the headless profile did not load any material up front */
+	UMaterialInterface* Loaded = TSoftObjectPtr<UMaterialInterface>(Material).LoadSynchronous();
+	if (not Loaded and not Material.IsNull()) {
+		UE_LOG(LogTh3SMBuilderCpp, Warning, TEXT("Could not load material %s for %s"), *Material.ToString(), *Th3::GetPathSafe(Buildable));
+	}
+	Buildable->SetMaterialForIndex(Index, Loaded);
+}
+
+void UTh3SMBuilderRCO::GrantRecipe(UWorld* World, TSubclassOf<UFGRecipe> Recipe)
+{
+	const UTh3SMBuilderRootInstance* RootInstance = UTh3SMBuilderRootInstance::Get(World);
+	if (not RootInstance or not RootInstance->IsLazyRecipe(Recipe)) {
+		UE_LOG(LogTh3SMBuilderCpp, Warning, TEXT("Refusing to unlock %s, it is not a lazily unlocked recipe"), *Th3::GetPathSafe(Recipe));
+		return;
+	}
+	AFGRecipeManager* RecipeManager = AFGRecipeManager::Get(World);
+	if (not RecipeManager) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not find recipe manager"));
+		return;
+	}
+	if (not RecipeManager->IsRecipeAvailable(Recipe)) {
+		RecipeManager->AddAvailableRecipe(Recipe);
+	}
+}
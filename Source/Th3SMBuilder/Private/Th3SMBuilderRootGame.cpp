@@ -2,7 +2,10 @@
 
 #include "Th3SMBuilderRootGame.h"
 #include "Th3SMBuilderRootInstance.h"
+#include "Th3SMBuilderSavePalette.h"
+#include "Th3SMBuilderRCO.h"
 #include "Th3SMBuilder.h"
+#include "Th3SMBuilderStats.h"
 
 #include "Module/GameInstanceModuleManager.h"
 #include "Registry/ModContentRegistry.h"
@@ -24,8 +27,42 @@ UTh3SMBuilderRootGame::~UTh3SMBuilderRootGame()
 	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Goodbye Cruel Game World"));
 }
 
+void UTh3SMBuilderRootGame::BeginDestroy()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(UnlockTicker);
+	UnlockTicker.Reset();
+	Super::BeginDestroy();
+}
+
+bool UTh3SMBuilderRootGame::TryGiveAccessToSchematics(float DeltaTime)
+{
+	/* Recipes are added to the schematic while buildables get generated */
+	UTh3SMBuilderRootInstance* RootInstance = UTh3SMBuilderRootInstance::Get(GetWorld());
+	if (RootInstance and not RootInstance->bBuildablesReady) {
+		return true;
+	}
+	UnlockTicker.Reset();
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_SchematicUnlock);
+	AFGSchematicManager* SchematicManager = AFGSchematicManager::Get(GetWorld());
+	if (not SchematicManager) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not find schematic manager"));
+		return false;
+	}
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Making Static Mesh recipes available..."));
+	Algo::ForEach(mSchematics, [SchematicManager](const TSubclassOf<UFGSchematic>& Schematic) {
+		SchematicManager->GiveAccessToSchematic(Schematic, nullptr);
+	});
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Made Static Mesh recipes available"));
+	return false;
+}
+
 void UTh3SMBuilderRootGame::DispatchLifecycleEvent(ELifecyclePhase Phase)
 {
+	/* Has to be there before the base class registers them */
+	if (Phase == ELifecyclePhase::CONSTRUCTION) {
+		ModSubsystems.AddUnique(ATh3SMBuilderSavePalette::StaticClass());
+		mRemoteCallObjects.AddUnique(UTh3SMBuilderRCO::StaticClass());
+	}
 	Super::DispatchLifecycleEvent(Phase);
 
 	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Dispatching Phase %s on %s"), *LifecyclePhaseToString(Phase), *this->GetPathName());
@@ -33,16 +70,10 @@ void UTh3SMBuilderRootGame::DispatchLifecycleEvent(ELifecyclePhase Phase)
 #if !0
 	/* TODO: Unlocking the schematic seems to be really slow */
 	if (Phase == ELifecyclePhase::POST_INITIALIZATION) {
-		AFGSchematicManager* SchematicManager = AFGSchematicManager::Get(GetWorld());
-		if (not SchematicManager) {
-			UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not find schematic manager"));
-			return;
+		if (TryGiveAccessToSchematics(0.0f)) {
+			UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Waiting for buildables before making recipes available..."));
+			UnlockTicker = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UTh3SMBuilderRootGame::TryGiveAccessToSchematics));
 		}
-		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Making Static Mesh recipes available..."));
-		Algo::ForEach(mSchematics, [SchematicManager](const TSubclassOf<UFGSchematic>& Schematic) {
-			SchematicManager->GiveAccessToSchematic(Schematic, nullptr);
-		});
-		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Made Static Mesh recipes available"));
 	}
 #endif
 }
\ No newline at end of file
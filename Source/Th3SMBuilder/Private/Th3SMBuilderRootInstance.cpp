@@ -2,8 +2,14 @@
 
 #include "Th3SMBuilderRootInstance.h"
 #include "Th3Utilities.h"
+#include "Th3SMBuilderStats.h"
 
 #include "Containers/EnumAsByte.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Hash/xxhash.h"
+#include "StaticMeshResources.h"
+#include "HAL/PlatformMemory.h"
 #include "Registry/ModContentRegistry.h"
 #include "Resources/FGBuildingDescriptor.h"
 #include "Module/GameInstanceModuleManager.h"
@@ -11,14 +17,17 @@
 #include "FGRecipe.h"
 #include "FGRecipeManager.h"
 #include "FGSchematic.h"
+#include "Async/ParallelFor.h"
 #include "Logging/LogMacros.h"
 #include "Logging/StructuredLog.h"
 #include "UObject/UObjectGlobals.h"
 #include "Algo/Accumulate.h"
 #include "Algo/AllOf.h"
 #include "Algo/AnyOf.h"
+#include "Algo/Copy.h"
 #include "Algo/ForEach.h"
 #include "Algo/Reverse.h"
+#include "Algo/Sort.h"
 #include "Algo/Transform.h"
 
 UTh3SMBuilderRootInstance::UTh3SMBuilderRootInstance()
@@ -31,18 +40,27 @@ UTh3SMBuilderRootInstance::~UTh3SMBuilderRootInstance()
 	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Goodbye Cruel Game Instance"));
 }
 
-TSubclassOf<UFGBuildCategory> UTh3SMBuilderRootInstance::MakeCategory()
+void UTh3SMBuilderRootInstance::BeginDestroy()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(GenerationTicker);
+	GenerationTicker.Reset();
+	MeshLoadHandle.Reset();
+	FTSTicker::GetCoreTicker().RemoveTicker(MaterialStreamTicker);
+	MaterialStreamTicker.Reset();
+	Super::BeginDestroy();
+}
+
+TSubclassOf<UFGBuildCategory> UTh3SMBuilderRootInstance::MakeCategory(const int32 Idx)
 {
-	const int32 Idx = Priority / EntriesPerCategory;
-	
 	if (BuildCategories.IsValidIndex(Idx)) {
 		return BuildCategories[Idx];
 	}
-	const FString PackagePath = MOD_TRANSIENT_ROOT / TEXT("Categories");
+	const FName PackagePath(MOD_TRANSIENT_ROOT / TEXT("Categories"));
 	const FString ClassName = FString::Printf(TEXT("Cat_%d"), Idx);
-	TSubclassOf<UFGBuildCategory> Category = Th3Utilities::GenerateNewClass(PackagePath, ClassName, UFGBuildCategory::StaticClass());
+	/* Shares the package with path categories, so it has to go through the same generator */
+	TSubclassOf<UFGBuildCategory> Category = ClassGenerator.Generate(PackagePath, ClassGenerator.MakeUniqueName(PackagePath, ClassName, ClassName), UFGBuildCategory::StaticClass());
 	if (not Category) {
-		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Failed to generate Category for %s %s"), *PackagePath, *ClassName);
+		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Failed to generate Category for %s %s"), *PackagePath.ToString(), *ClassName);
 		return nullptr;
 	}
 	UFGBuildCategory* CDO = Category.GetDefaultObject();
@@ -53,80 +71,256 @@ TSubclassOf<UFGBuildCategory> UTh3SMBuilderRootInstance::MakeCategory()
 	return Category;
 }
 
-void UTh3SMBuilderRootInstance::MakeBuildable(UStaticMesh* Mesh)
+static FString SanitizeClassName(const FString& Label)
+{
+	FString Name = Label;
+	for (TCHAR& Char : Name) {
+		Char = FChar::IsAlnum(Char) ? Char : TEXT('_');
+	}
+	return Name;
+}
+
+void UTh3SMBuilderRootInstance::MakePathCategories()
+{
+	const FName PackagePath(MOD_TRANSIENT_ROOT / TEXT("Categories"));
+	const auto make_class = [this, &PackagePath](const FTh3CategoryTrie::FGroup& Group, const TCHAR* Prefix, UClass* ParentClass, const int32 Idx) {
+		const FName ClassName = ClassGenerator.MakeUniqueName(PackagePath, Prefix + SanitizeClassName(Group.Label), Group.Label);
+		UClass* Class = ClassGenerator.Generate(PackagePath, ClassName, ParentClass);
+		if (not Class) {
+			UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Failed to generate Category for %s %s"), *PackagePath.ToString(), *ClassName.ToString());
+			return Class;
+		}
+		UFGCategory* CDO = CastChecked<UFGCategory>(Class->GetDefaultObject());
+		CDO->mDisplayName = FText::FromString(Group.Label);
+		CDO->mCategoryIcon = UFGCategory::GetCategoryIcon(BuildCategory);
+		CDO->mMenuPriority = Idx + 42;
+		return Class;
+	};
+	const TArray<FTh3CategoryTrie::FGroup>& Categories = CategoryTrie.GetCategories();
+	for (int32 Idx = 0; Idx < Categories.Num(); Idx++) {
+		PathCategories.Add(make_class(Categories[Idx], TEXT("Cat_"), UFGBuildCategory::StaticClass(), Idx));
+	}
+	const TArray<FTh3CategoryTrie::FGroup>& SubCategories = CategoryTrie.GetSubCategories();
+	for (int32 Idx = 0; Idx < SubCategories.Num(); Idx++) {
+		PathSubCategories.Add(make_class(SubCategories[Idx], TEXT("SubCat_"), UFGBuildSubCategory::StaticClass(), Idx));
+	}
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Made %d categories with %d sub-categories from mesh paths"), PathCategories.Num(), PathSubCategories.Num());
+}
+
+void UTh3SMBuilderRootInstance::MakePlans()
 {
-	const FString PackagePath = MOD_TRANSIENT_ROOT / TEXT("Buildables") / Mesh->GetPackage()->GetName();
-	const FString ClassName = FString::Printf(TEXT("Build_%s"), *Mesh->GetName());
-	TSubclassOf<ATh3BuildableSM> Buildable = Th3Utilities::GenerateNewClass(PackagePath, ClassName, ATh3BuildableSM::StaticClass());
+	Plans.SetNum(SMPtrs.Num());
+	ParallelFor(Plans.Num(), [this](const int32 Idx) {
+		Plans[Idx].MeshPtr = SMPtrs[Idx];
+		Plans[Idx].MeshPath = SMPtrs[Idx].ToSoftObjectPath().ToString();
+	});
+	/* Discovery order depends on the asset registry, path order does not */
+	Algo::SortBy(Plans, &FTh3BuildablePlan::MeshPath);
+	for (int32 Idx = 0; Idx < Plans.Num(); Idx++) {
+		SMPtrs[Idx] = Plans[Idx].MeshPtr;
+	}
+	if (CategoryMode == ETh3CategoryMode::ByPath) {
+		TArray<FString> PackagePaths;
+		Algo::Transform(Plans, PackagePaths, [](const FTh3BuildablePlan& Plan) { return Plan.MeshPtr.ToSoftObjectPath().GetLongPackageName(); });
+		CategoryTrie.Build(PackagePaths, MaxCategories, MaxSubCategories);
+	}
+
+	ParallelFor(Plans.Num(), [this](const int32 Idx) {
+		FTh3BuildablePlan& Plan = Plans[Idx];
+		const FSoftObjectPath& MeshPath = Plan.MeshPtr.ToSoftObjectPath();
+		const FString MeshPackage = MeshPath.GetLongPackageName();
+		/* Either one package per mount root, or one per mesh */
+		Plan.BuildablePackage = FName(MOD_TRANSIENT_ROOT / TEXT("Buildables") / (bSharedClassPackages ? FTh3DiscoveryManifest::GetMountRoot(MeshPackage) : MeshPackage));
+		Plan.BuildableName = FName(FString::Printf(TEXT("Build_%s"), *MeshPath.GetAssetName()));
+		Plan.MeshId = Idx;
+		if (CategoryMode == ETh3CategoryMode::ByPath) {
+			const TPair<int32, int32> Groups = CategoryTrie.Find(MeshPackage);
+			Plan.Category = Groups.Key;
+			Plan.SubCategory = Groups.Value;
+		}
+	});
+
+	/* Serial and in path order, so that colliding names always get the same suffix */
+	for (FTh3BuildablePlan& Plan : Plans) {
+		Plan.BuildableName = ClassGenerator.ClaimUniqueName(Plan.BuildablePackage, Plan.BuildableName, Plan.MeshPath);
+	}
+
+	ParallelFor(Plans.Num(), [this](const int32 Idx) {
+		FTh3BuildablePlan& Plan = Plans[Idx];
+		const FString BuildableName = Plan.BuildableName.ToString();
+		const FString DescPackage = MOD_TRANSIENT_ROOT / TEXT("BuildingDesc") / Plan.BuildablePackage.ToString();
+		Plan.DescPackage = FName(DescPackage);
+		Plan.DescName = FName(FString::Printf(TEXT("Desc_%s"), *BuildableName));
+		Plan.RecipePackage = FName(MOD_TRANSIENT_ROOT / TEXT("Recipes") / DescPackage);
+		Plan.RecipeName = FName(FString::Printf(TEXT("Recipe_Desc_%s"), *BuildableName));
+	});
+}
+
+void UTh3SMBuilderRootInstance::MakeBuildable(const FTh3BuildablePlan& Plan)
+{
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_MakeBuildable);
+	TSubclassOf<ATh3BuildableSM> Buildable = ClassGenerator.Generate(Plan.BuildablePackage, Plan.BuildableName, ATh3BuildableSM::StaticClass());
 	if (not Buildable) {
-		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Failed to generate buildable for %s %s"), *PackagePath, *ClassName);
+		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Failed to generate buildable for %s %s"), *Plan.BuildablePackage.ToString(), *Plan.BuildableName.ToString());
 		return;
 	}
 	ATh3BuildableSM* CDO = Buildable.GetDefaultObject();
-	CDO->mDisplayName = FText::FromString(ClassName);
-	CDO->mDescription = FText::FromString(Mesh->GetPathName());
+	CDO->mDisplayName = FText::FromName(Plan.BuildableName);
+	CDO->mDescription = FText::FromString(Plan.MeshPath);
 	CDO->mHologramClass = HologramClass;
 	CDO->mInteractWidgetSoftClass = InteractWidgetClass;
 	CDO->FallbackMaterial = FallbackMaterial;
 	CDO->CollisionProfile = CollisionProfile;
-	CDO->SetMesh(Mesh);
+	CDO->MeshPtr = Plan.MeshPtr;
+	CDO->MeshId = Plan.MeshId;
+	CDO->bUseInstancedRendering = bUseInstancedRendering;
+	CDO->CollisionPolicy = CollisionPolicy;
+	if (MeshResidency) {
+		/* Loaded through the residency manager once something needs it */
+		BuildablesByMesh.Add(Plan.MeshPtr.ToSoftObjectPath(), CDO);
+	} else if (UStaticMesh* Mesh = Plan.MeshPtr.Get()) {
+		CDO->SetMesh(Mesh);
+	}
 
 	Buildables.Add(CDO);
+	INC_DWORD_STAT(STAT_Th3_NumBuildables);
 
-	//UE_LOG(LogTh3SMBuilderCpp, Warning, TEXT("[PRIOWTF]\t%d\tBUILD\t%s"), Priority, *Th3::GetPathSafe(Buildable));
-
-	MakeBuildingDescriptor(Buildable);
+	MakeBuildingDescriptor(Buildable, Plan);
 }
 
-void UTh3SMBuilderRootInstance::MakeBuildingDescriptor(TSubclassOf<ATh3BuildableSM> Buildable)
+void UTh3SMBuilderRootInstance::MakeBuildingDescriptor(TSubclassOf<ATh3BuildableSM> Buildable, const FTh3BuildablePlan& Plan)
 {
-	const FString PackagePath = MOD_TRANSIENT_ROOT / TEXT("BuildingDesc") / Buildable->GetPackage()->GetName();
-	const FString ClassName = FString::Printf(TEXT("Desc_%s"), *Buildable->GetName());
-	TSubclassOf<UFGBuildingDescriptor> BuildDesc = Th3Utilities::GenerateNewClass(PackagePath, ClassName, UFGBuildingDescriptor::StaticClass());
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_MakeDescriptor);
+	TSubclassOf<UFGBuildingDescriptor> BuildDesc = ClassGenerator.Generate(Plan.DescPackage, Plan.DescName, UFGBuildingDescriptor::StaticClass());
 	if (not BuildDesc) {
-		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Failed to generate desc for %s %s"), *PackagePath, *ClassName);
+		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Failed to generate desc for %s %s"), *Plan.DescPackage.ToString(), *Plan.DescName.ToString());
 		return;
 	}
 	UFGBuildingDescriptor* CDO = BuildDesc.GetDefaultObject();
 	CDO->mBuildableClass = Buildable;
 	CDO->mSmallIcon = ItemIcon;
 	CDO->mPersistentBigIcon = ItemIcon;
-	CDO->mCategory = MakeCategory();
-	CDO->mSubCategories.Add(BuildSubCategory);
-	CDO->mMenuPriority = Priority + 42;
+	if (CategoryMode == ETh3CategoryMode::ByPath) {
+		CDO->mCategory = PathCategories.IsValidIndex(Plan.Category) ? PathCategories[Plan.Category] : MakeCategory(Plan.Priority / EntriesPerCategory);
+		CDO->mSubCategories.Add(PathSubCategories.IsValidIndex(Plan.SubCategory) ? PathSubCategories[Plan.SubCategory] : BuildSubCategory);
+	} else {
+		CDO->mCategory = MakeCategory(Plan.Category);
+		CDO->mSubCategories.Add(BuildSubCategory);
+	}
+	CDO->mMenuPriority = Plan.Priority + 42;
 
-	MakeBuildingRecipe(BuildDesc);
+	MakeBuildingRecipe(BuildDesc, Plan);
 }
 
-void UTh3SMBuilderRootInstance::MakeBuildingRecipe(TSubclassOf<UFGBuildingDescriptor> BuildDesc)
+void UTh3SMBuilderRootInstance::MakeBuildingRecipe(TSubclassOf<UFGBuildingDescriptor> BuildDesc, const FTh3BuildablePlan& Plan)
 {
-	const FString PackagePath = MOD_TRANSIENT_ROOT / TEXT("Recipes") / BuildDesc->GetPackage()->GetName();
-	const FString ClassName = FString::Printf(TEXT("Recipe_%s"), *BuildDesc->GetName());
-	TSubclassOf<UFGRecipe> Recipe = Th3Utilities::GenerateNewClass(PackagePath, ClassName, UFGRecipe::StaticClass());
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_MakeRecipe);
+	TSubclassOf<UFGRecipe> Recipe = ClassGenerator.Generate(Plan.RecipePackage, Plan.RecipeName, UFGRecipe::StaticClass());
 	if (not Recipe) {
-		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Failed to generate recipe for %s %s"), *PackagePath, *ClassName);
+		UE_LOG(LogTh3SMBuilderCpp, Fatal, TEXT("Failed to generate recipe for %s %s"), *Plan.RecipePackage.ToString(), *Plan.RecipeName.ToString());
 		return;
 	}
 	UFGRecipe* CDO = Recipe.GetDefaultObject();
 	CDO->mProduct.Add(FItemAmount(BuildDesc, 1));
 	CDO->mProducedIn.Add(BuildGunClass);
 
-	ModifiedUnlock->mRecipes.Add(Recipe);
+	RecipesByDescriptor.Add(BuildDesc, Recipe);
+	if (bLazyRecipeUnlock) {
+		LazyRecipes.Add(Recipe);
+	} else {
+		ModifiedUnlock->mRecipes.Add(Recipe);
+	}
 }
 
-void UTh3SMBuilderRootInstance::ProcessOneSM(const TSoftObjectPtr<UStaticMesh>& MeshPtr)
+void UTh3SMBuilderRootInstance::ProcessOneSM(FTh3BuildablePlan& Plan)
 {
-	UStaticMesh* Mesh = MeshPtr.Get();
+	/* Counts only meshes that get a buildable, so categories by count have no gaps */
+	const auto commit = [this, &Plan]() {
+		Plan.Priority = Buildables.Num();
+		if (CategoryMode != ETh3CategoryMode::ByPath) {
+			Plan.Category = Plan.Priority / EntriesPerCategory;
+		}
+		MakeBuildable(Plan);
+	};
+	if (bGenerateFromAssetData) {
+		/* The mesh is not loaded, everything comes from its path */
+		commit();
+		return;
+	}
+	UStaticMesh* Mesh = Plan.MeshPtr.Get();
 	if (not Mesh) {
-		//UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Got nullptr StaticMesh"));
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not load static mesh %s, not generating a buildable for it"), *Plan.MeshPtr.ToString());
 		return;
 	}
 	if (Mesh->HasAnyFlags(RF_ClassDefaultObject)) {
 		return;
 	}
-	StaticMeshes.Add(Mesh);
-	MakeBuildable(Mesh);
-	Priority++;
+	const uint64 Hash = bDeduplicateMeshes ? HashGeometry(Mesh) : 0;
+	if (Hash != 0) {
+		if (ATh3BuildableSM** Found = BuildablesByGeometry.Find(Hash)) {
+			AddMeshAlias(*Found, Plan);
+			return;
+		}
+	}
+	if (not MeshResidency) {
+		StaticMeshes.Add(Mesh);
+	}
+	commit();
+	if (Hash != 0) {
+		BuildablesByGeometry.Add(Hash, Buildables.Last());
+	}
+}
+
+void UTh3SMBuilderRootInstance::OnMeshEvicted(const FSoftObjectPath& MeshPath)
+{
+	if (ATh3BuildableSM** CDO = BuildablesByMesh.Find(MeshPath)) {
+		(*CDO)->SetMesh(nullptr);
+	}
+}
+
+void UTh3SMBuilderRootInstance::AddMeshAlias(ATh3BuildableSM* CDO, const FTh3BuildablePlan& Plan)
+{
+	CDO->MeshAliases.Add(Plan.MeshPtr.ToSoftObjectPath());
+	FString Description = CDO->MeshPtr.ToString();
+	for (const FSoftObjectPath& Alias : CDO->MeshAliases) {
+		Description += TEXT("\n") + Alias.ToString();
+	}
+	CDO->mDescription = FText::FromString(Description);
+	INC_DWORD_STAT(STAT_Th3_NumMeshAliases);
+}
+
+uint64 UTh3SMBuilderRootInstance::HashGeometry(const UStaticMesh* Mesh)
+{
+	const FStaticMeshRenderData* RenderData = Mesh->GetRenderData();
+	if (not RenderData or RenderData->LODResources.IsEmpty()) {
+		return 0;
+	}
+	const FStaticMeshLODResources& LOD = RenderData->LODResources[0];
+	/* Only there if the mesh allows CPU access, counts and bounds alone would merge different meshes */
+	const FPositionVertexBuffer& Positions = LOD.VertexBuffers.PositionVertexBuffer;
+	const void* Data = Positions.GetVertexData();
+	if (not Data) {
+		return 0;
+	}
+	FXxHash64Builder Builder;
+	const auto update = [&Builder](const auto& Value) { Builder.Update(&Value, sizeof(Value)); };
+
+	update(LOD.GetNumVertices());
+	update(LOD.GetNumTriangles());
+	for (const FStaticMeshSection& Section : LOD.Sections) {
+		update(Section.MaterialIndex);
+		update(Section.FirstIndex);
+		update(Section.NumTriangles);
+	}
+	Builder.Update(Data, Positions.GetNumVertices() * Positions.GetStride());
+	/* Quantized to millimetres */
+	update(FIntVector(RenderData->Bounds.Origin * 10.0));
+	update(FIntVector(RenderData->Bounds.BoxExtent * 10.0));
+
+	for (const FStaticMaterial& Material : Mesh->GetStaticMaterials()) {
+		update(GetTypeHash(GetPathNameSafe(Material.MaterialInterface)));
+	}
+	return Builder.Finalize().Hash;
 }
 
 void UTh3SMBuilderRootInstance::ProcessOneMat(const FSoftObjectPath& MatPath)
@@ -144,21 +338,169 @@ void UTh3SMBuilderRootInstance::ProcessOneMat(const FSoftObjectPath& MatPath)
 	Materials.Add(Mat);
 }
 
+TArray<FSoftObjectPath> UTh3SMBuilderRootInstance::DiscoverAllOf(UClass* BaseClass)
+{
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_Discovery);
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Looking for '%s'..."), *BaseClass->GetName());
+	TArray<FSoftObjectPath> AllPaths;
+	if (bUseDiscoveryManifest) {
+		DiscoveryManifest.Discover(BaseClass, AllPaths);
+		SET_MEMORY_STAT(STAT_Th3_DiscoveryManifestMemory, DiscoveryManifest.GetAllocatedSize());
+	} else {
+		TArray<FAssetData> AssetData;
+		IAssetRegistry::Get()->GetAssetsByClass(FTopLevelAssetPath(BaseClass), AssetData, true);
+		Algo::Transform(AssetData, AllPaths, [](const FAssetData& Asset) { return Asset.GetSoftObjectPath(); });
+	}
+	PathMatcher.Compile(IncludePaths, ExcludePaths);
+	TArray<FSoftObjectPath> SoftPaths;
+	const auto path_predicate = [this](const FSoftObjectPath& Path) { return PathMatcher.IsIncluded(Path.GetLongPackageFName()); };
+	Algo::CopyIf(AllPaths, SoftPaths, path_predicate);
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Kept %d out of %d '%s' after path rules"), SoftPaths.Num(), AllPaths.Num(), *BaseClass->GetName());
+	return SoftPaths;
+}
+
 void UTh3SMBuilderRootInstance::ProcessStaticMeshes()
 {
 	const auto store_paths = [this](const TArray<FSoftObjectPath>& InPaths) {
 		Algo::Transform(InPaths, SMPtrs, &ToSoftObjectPtr<UStaticMesh>);
 	};
 	const auto proc_paths = [this]() {
-		Algo::ForEach(SMPtrs, TH3_PROJECTION_THIS(ProcessOneSM));
-		bBuildablesReady = true;
-		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Buildableabled %d static meshes"), StaticMeshes.Num());
+		StartGeneration();
 	};
-	ProcessAllOf(UStaticMesh::StaticClass(), store_paths, proc_paths);
+	if (bGenerateFromAssetData) {
+		store_paths(DiscoverAllOf(UStaticMesh::StaticClass()));
+		proc_paths();
+		return;
+	}
+	MeshLoadHandle = ProcessAllOf(UStaticMesh::StaticClass(), store_paths, proc_paths);
+	/* Loading can finish right away, and generating along with it */
+	if (bBuildablesReady) {
+		MeshLoadHandle.Reset();
+	}
+}
+
+void UTh3SMBuilderRootInstance::StartGeneration()
+{
+	NextMeshIndex = 0;
+	/* A buildable, a descriptor and a recipe for every mesh */
+	ClassGenerator.Reserve(SMPtrs.Num() * 3);
+	MakePlans();
+	/* Both rely on the order MakePlans sorted SMPtrs in */
+	MeshMetadata.Build(SMPtrs);
+	if (CategoryMode == ETh3CategoryMode::ByPath) {
+		MakePathCategories();
+	}
+	if (GenerationBudgetMs <= 0.0f) {
+		TickGeneration(0.0f);
+		return;
+	}
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Generating %d buildables with a budget of %f ms per frame"), SMPtrs.Num(), GenerationBudgetMs);
+	GenerationTicker = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UTh3SMBuilderRootInstance::TickGeneration));
+}
+
+bool UTh3SMBuilderRootInstance::TickGeneration(float DeltaTime)
+{
+	const double Deadline = FPlatformTime::Seconds() + GenerationBudgetMs / 1000.0;
+	while (Plans.IsValidIndex(NextMeshIndex)) {
+		ProcessOneSM(Plans[NextMeshIndex++]);
+		if (GenerationBudgetMs > 0.0f and FPlatformTime::Seconds() >= Deadline) {
+			break;
+		}
+	}
+	if (Plans.IsValidIndex(NextMeshIndex)) {
+		UE_LOG(LogTh3SMBuilderCpp, Verbose, TEXT("Generated buildables for %d out of %d static meshes"), NextMeshIndex, Plans.Num());
+		return true;
+	}
+	GenerationTicker.Reset();
+	/* Plans are only needed while generating, and meshes are now kept by StaticMeshes or MeshResidency */
+	Plans.Empty();
+	MeshLoadHandle.Reset();
+	bBuildablesReady = true;
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Buildableabled %d static meshes"), Buildables.Num());
+	return false;
+}
+
+float UTh3SMBuilderRootInstance::GetBuildablesProgress() const
+{
+	if (bBuildablesReady or SMPtrs.IsEmpty()) {
+		return bBuildablesReady ? 1.0f : 0.0f;
+	}
+	return static_cast<float>(NextMeshIndex) / SMPtrs.Num();
+}
+
+bool UTh3SMBuilderRootInstance::IsOverMaterialMemoryCeiling() const
+{
+	if (MaterialMemoryCeilingMB <= 0) {
+		return false;
+	}
+	return FPlatformMemory::GetStats().UsedPhysical > MaterialMemoryBaseline + uint64(MaterialMemoryCeilingMB) * 1024 * 1024;
+}
+
+void UTh3SMBuilderRootInstance::StreamNextMaterialBatch()
+{
+	if (not MatPtrs.IsValidIndex(NextMaterialIndex)) {
+		bMaterialsReady = true;
+		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Streamed %d materials"), MaterialInfos.Num());
+		return;
+	}
+	if (IsOverMaterialMemoryCeiling()) {
+		if (NumMaterialMemoryWaits >= 10) {
+			/* Something else is holding on to the memory, waiting longer will not help */
+			UE_LOG(LogTh3SMBuilderCpp, Warning, TEXT("Still over the material memory ceiling after %d garbage collections, streaming on anyway"), NumMaterialMemoryWaits);
+			MaterialMemoryBaseline = FPlatformMemory::GetStats().UsedPhysical;
+			NumMaterialMemoryWaits = 0;
+			StreamNextMaterialBatch();
+			return;
+		}
+		/* Released batches only go away once garbage is collected */
+		UE_LOG(LogTh3SMBuilderCpp, Verbose, TEXT("Over the material memory ceiling, waiting for garbage collection"));
+		NumMaterialMemoryWaits++;
+		GEngine->ForceGarbageCollection(true);
+		MaterialStreamTicker = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(this, [this](float DeltaTime) {
+			MaterialStreamTicker.Reset();
+			StreamNextMaterialBatch();
+			return false;
+		}), 0.5f);
+		return;
+	}
+	NumMaterialMemoryWaits = 0;
+	const int32 BatchEnd = FMath::Min(NextMaterialIndex + FMath::Max(MaterialBatchSize, 1), MatPtrs.Num());
+	TArray<FSoftObjectPath> Batch;
+	Batch.Reserve(BatchEnd - NextMaterialIndex);
+	for (; NextMaterialIndex < BatchEnd; NextMaterialIndex++) {
+		Batch.Add(MatPtrs[NextMaterialIndex].ToSoftObjectPath());
+	}
+	/* Nobody keeps the handle, so the batch is released once the callback returns */
+	const FStreamableDelegate Callback = FStreamableDelegate::CreateUObject(this, &UTh3SMBuilderRootInstance::OnMaterialBatchLoaded, Batch);
+	UAssetManager::GetStreamableManager().RequestAsyncLoad(Batch, Callback, FStreamableManager::AsyncLoadHighPriority);
+}
+
+void UTh3SMBuilderRootInstance::OnMaterialBatchLoaded(TArray<FSoftObjectPath> Batch)
+{
+	for (const FSoftObjectPath& MatPath : Batch) {
+		UMaterialInterface* Mat = Cast<UMaterialInterface>(MatPath.ResolveObject());
+		if (not Mat or Mat->HasAnyFlags(RF_ClassDefaultObject)) {
+			continue;
+		}
+		FTh3MaterialInfo& Info = MaterialInfos.AddDefaulted_GetRef();
+		Info.Material = Mat;
+		Info.Domain = Mat->GetBaseMaterial()->MaterialDomain;
+	}
+	UE_LOG(LogTh3SMBuilderCpp, Verbose, TEXT("Streamed %d out of %d materials"), NextMaterialIndex, MatPtrs.Num());
+	StreamNextMaterialBatch();
 }
 
 void UTh3SMBuilderRootInstance::ProcessMaterialInterfaces()
 {
+	if (bStreamMaterials) {
+		Algo::Transform(DiscoverAllOf(UMaterialInterface::StaticClass()), MatPtrs, &ToSoftObjectPtr<UMaterialInterface>);
+		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Streaming %d materials in batches of %d"), MatPtrs.Num(), MaterialBatchSize);
+		NextMaterialIndex = 0;
+		MaterialMemoryBaseline = FPlatformMemory::GetStats().UsedPhysical;
+		NumMaterialMemoryWaits = 0;
+		StreamNextMaterialBatch();
+		return;
+	}
 	LoadAsync(UMaterialInterface::StaticClass(), [this](const TArray<FSoftObjectPath>& Paths) {
 		Algo::ForEach(Paths, TH3_PROJECTION_THIS(ProcessOneMat));
 		bMaterialsReady = true;
@@ -180,8 +522,27 @@ void UTh3SMBuilderRootInstance::DispatchLifecycleEvent(ELifecyclePhase Phase)
 		ModifiedUnlock = Cast<UFGUnlockRecipe>(ModifiedSchematicCDO->mUnlocks[0]);
 
 		fgcheck(ModifiedUnlock);
+		if (bLazyRecipeUnlock and BrowserRecipe) {
+			ModifiedUnlock->mRecipes.AddUnique(BrowserRecipe);
+		}
+		if (bUseDiscoveryManifest) {
+			DiscoveryManifest.Load();
+		}
+		if (bUseMeshResidency) {
+			MeshResidency = NewObject<UTh3MeshResidency>(this);
+			MeshResidency->BudgetBytes = static_cast<int64>(MeshResidencyBudgetMB) * 1024 * 1024;
+			MeshResidency->OnMeshEvicted.AddUObject(this, &UTh3SMBuilderRootInstance::OnMeshEvicted);
+		}
 		ProcessStaticMeshes();
-		ProcessMaterialInterfaces();
+		if (IsHeadlessServer()) {
+			UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Dedicated server, not looking for materials"));
+			bMaterialsReady = true;
+		} else {
+			ProcessMaterialInterfaces();
+		}
+		if (bUseDiscoveryManifest) {
+			DiscoveryManifest.SaveIfDirty();
+		}
 	}
 }
 
@@ -191,7 +552,11 @@ UTh3SMBuilderRootInstance* UTh3SMBuilderRootInstance::Get(UWorld* World)
 		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("  - nullptr World"));
 		return nullptr;
 	}
-	UGameInstance* GameInstance = World->GetGameInstance();
+	return UTh3SMBuilderRootInstance::Get(World->GetGameInstance());
+}
+
+UTh3SMBuilderRootInstance* UTh3SMBuilderRootInstance::Get(const UGameInstance* GameInstance)
+{
 	if (not GameInstance) {
 		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("  - nullptr GameInstance"));
 		return nullptr;
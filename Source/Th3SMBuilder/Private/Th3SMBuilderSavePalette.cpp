@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3SMBuilderSavePalette.h"
+#include "Th3SMBuilder.h"
+#include "Th3BuildableSM.h"
+
+#include "EngineUtils.h"
+#include "Kismet/GameplayStatics.h"
+
+ATh3SMBuilderSavePalette::ATh3SMBuilderSavePalette() : AModSubsystem()
+{
+	/* Only the server saves */
+	ReplicationPolicy = ESubsystemReplicationPolicy::SpawnOnServer;
+}
+
+ATh3SMBuilderSavePalette* ATh3SMBuilderSavePalette::Get(UObject* WorldContext)
+{
+	return Cast<ATh3SMBuilderSavePalette>(UGameplayStatics::GetActorOfClass(WorldContext, ATh3SMBuilderSavePalette::StaticClass()));
+}
+
+void ATh3SMBuilderSavePalette::PreSaveGame_Implementation(int32 saveVersion, int32 gameVersion)
+{
+	Materials.Reset();
+	Strings.Reset();
+	MaterialIndices.Reset();
+	StringIndices.Reset();
+	/* Filled from here, so it does not matter whether buildables get PreSaveGame before or after */
+	for (TActorIterator<ATh3BuildableSM> It(GetWorld()); It; ++It) {
+		It->WriteToPalette(*this);
+	}
+}
+
+void ATh3SMBuilderSavePalette::PostSaveGame_Implementation(int32 saveVersion, int32 gameVersion)
+{
+	/* Only needed while buildables are adding to the palette */
+	MaterialIndices.Empty();
+	StringIndices.Empty();
+}
+
+int32 ATh3SMBuilderSavePalette::AddMaterial(UMaterialInterface* Material)
+{
+	if (const int32* Found = MaterialIndices.Find(Material)) {
+		return *Found;
+	}
+	const int32 Index = Materials.Add(Material);
+	MaterialIndices.Add(Material, Index);
+	return Index;
+}
+
+int32 ATh3SMBuilderSavePalette::AddString(const FString& String)
+{
+	if (const int32* Found = StringIndices.Find(String)) {
+		return *Found;
+	}
+	const int32 Index = Strings.Add(String);
+	StringIndices.Add(String, Index);
+	return Index;
+}
+
+UMaterialInterface* ATh3SMBuilderSavePalette::GetMaterial(const int32 Index) const
+{
+	if (not Materials.IsValidIndex(Index)) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Material %d not in save palette of %d"), Index, Materials.Num());
+		return nullptr;
+	}
+	return Materials[Index];
+}
+
+FString ATh3SMBuilderSavePalette::GetString(const int32 Index) const
+{
+	if (not Strings.IsValidIndex(Index)) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("String %d not in save palette of %d"), Index, Strings.Num());
+		return FString();
+	}
+	return Strings[Index];
+}
@@ -1,11 +1,19 @@
 /* SPDX-License-Identifier: MPL-2.0 */
 
 #include "Th3SMBuilderSubsystem.h"
-#include "Algo/AllOf.h"
+#include "Th3SMBuilderStats.h"
 #include "Algo/Transform.h"
+#include "Engine/TextureRenderTarget2D.h"
 #include "Kismet/GameplayStatics.h"
 #include "MaterialDomain.h"
 
+ATh3SMBuilderSubsystem::ATh3SMBuilderSubsystem() : AModSubsystem()
+{
+	/* Only ticks while there are thumbnails to render */
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
+
 ATh3SMBuilderSubsystem* ATh3SMBuilderSubsystem::Get(UObject* WorldContext)
 {
 	return Cast<ATh3SMBuilderSubsystem>(UGameplayStatics::GetActorOfClass(WorldContext, ATh3SMBuilderSubsystem::StaticClass()));
@@ -13,24 +21,53 @@ ATh3SMBuilderSubsystem* ATh3SMBuilderSubsystem::Get(UObject* WorldContext)
 
 void ATh3SMBuilderSubsystem::GetFilteredEntries(TArray<UMaterialEntry*>& out_FilteredEntries, const FString& SearchQuery) const
 {
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_Search);
 	TArray<FString> SearchWords;
 	SearchQuery.ParseIntoArrayWS(SearchWords);
 	
 	if (not bEntriesReady) {
-		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("ENTRIES STILL NOT READY, THERE ARE %d ENTRIES"), MaterialEntries.Num());
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("ENTRIES STILL NOT READY, THERE ARE %d ENTRIES"), IndexedEntries.Num());
 	}
 	
-	const TFunction<bool(const TPair<UMaterialInterface*, UMaterialEntry*>&)> predicate_none = [](const TPair<UMaterialInterface*, UMaterialEntry*>& Pair) {
-		return true;
-	};
-	const TFunction<bool(const TPair<UMaterialInterface*, UMaterialEntry*>&)> predicate_find = [&SearchWords](const TPair<UMaterialInterface*, UMaterialEntry*>& Pair) {
-		const FString Path = Pair.Key->GetPathName();
-		return Algo::AllOf(SearchWords, [Path](const FString& Word) { return Path.Contains(Word); });
-	};
-	const auto transform = [](const TPair<UMaterialInterface*, UMaterialEntry*>& Pair) {
-		return Pair.Value;
-	};
-	Algo::TransformIf(MaterialEntries, out_FilteredEntries, SearchWords.IsEmpty() ? predicate_none : predicate_find, transform);
+	if (SearchWords.IsEmpty()) {
+		LastSearch.Reset();
+		out_FilteredEntries.Append(IndexedEntries);
+		return;
+	}
+	const TArray<int32>& Ids = LastSearch.Search(SearchIndex, SearchWords);
+	Algo::Transform(Ids, out_FilteredEntries, [this](const int32 Id) { return IndexedEntries[Id]; });
+}
+
+void ATh3SMBuilderSubsystem::SearchEntries(TArray<UMaterialEntry*>& out_Entries, const FString& SearchQuery, int32 MaxResults) const
+{
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_Search);
+	const FTh3SearchQuery Query = FTh3SearchQuery::Parse(SearchQuery);
+	if (Query.IsEmpty()) {
+		out_Entries.Append(IndexedEntries.GetData(), FMath::Clamp(MaxResults, 0, IndexedEntries.Num()));
+		return;
+	}
+	TArray<int32> Ids;
+	SearchIndex.Search(Query, MaxResults, Ids);
+	Algo::Transform(Ids, out_Entries, [this](const int32 Id) { return IndexedEntries[Id]; });
+}
+
+static FString GetMaterialDomainName(const EMaterialDomain Domain)
+{
+	FString Name = StaticEnum<EMaterialDomain>()->GetNameStringByValue(Domain);
+	Name.RemoveFromStart(TEXT("MD_"));
+	return Name;
+}
+
+void ATh3SMBuilderSubsystem::BuildSearchIndex()
+{
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_BuildSearchIndex);
+	LastSearch.Reset();
+	SearchIndex.Reset();
+	for (const UMaterialEntry* Entry : IndexedEntries) {
+		SearchIndex.Add(Entry->MaterialPtr.ToString(), GetMaterialDomainName(Entry->Domain));
+	}
+	SET_MEMORY_STAT(STAT_Th3_SearchIndexMemory, SearchIndex.GetAllocatedSize());
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Indexed %d materials for searching"), SearchIndex.Num());
 }
 
 TArray<UMaterialInterface*> ATh3SMBuilderSubsystem::GetMaterialsGame()
@@ -52,54 +89,257 @@ TArray<UMaterialInterface*> ATh3SMBuilderSubsystem::GetMaterials()
 	}
 }
 
-UMaterialEntry* ATh3SMBuilderSubsystem::MakeMaterialEntry(UMaterialInterface* Material, ASMBuilderPhotoBooth* PhotoBooth) const
+bool ATh3SMBuilderSubsystem::IsStreamingMaterials()
 {
-	const EMaterialDomain Domain = Material->GetBaseMaterial()->MaterialDomain;
-	//UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Making %s Material entry for '%s'"), *UEnum::GetValueAsString(Domain), *Material->GetPathName());
+	const UTh3SMBuilderRootInstance* RootInstance = UTh3SMBuilderRootInstance::Get(this);
+	return not GIsEditor and RootInstance and RootInstance->bStreamMaterials;
+}
+
+TArray<FTh3MaterialInfo> ATh3SMBuilderSubsystem::GetMaterialInfos()
+{
+	if (IsStreamingMaterials()) {
+		return UTh3SMBuilderRootInstance::Get(this)->MaterialInfos;
+	}
+	TArray<FTh3MaterialInfo> Infos;
+	Algo::Transform(GetMaterials(), Infos, [](UMaterialInterface* Material) {
+		FTh3MaterialInfo Info;
+		Info.Material = Material;
+		Info.Domain = Material->GetBaseMaterial()->MaterialDomain;
+		return Info;
+	});
+	return Infos;
+}
+
+UMaterialEntry* ATh3SMBuilderSubsystem::MakeMaterialEntry(const FTh3MaterialInfo& Info, UMaterialInterface* Material) const
+{
+	//UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Making %s Material entry for '%s'"), *UEnum::GetValueAsString(Info.Domain), *Info.Material.ToString());
 
 	UMaterialEntry* MaterialEntry = NewObject<UMaterialEntry>();
+	MaterialEntry->MaterialPtr = Info.Material;
+	MaterialEntry->Domain = Info.Domain;
+	MaterialEntry->Material = Material;
 
-	switch (Domain) {
-	case MD_Surface:
-		MaterialEntry->Brush = PhotoBooth->RenderSurfaceMaterial(Material, BrushSize);
-		break;
-	default:
+	if (Material and Info.Domain != MD_Surface) {
+		/* Not a surface and already loaded, so the material itself is the brush */
 		MaterialEntry->Brush.SetResourceObject(Material);
-		MaterialEntry->Brush.ImageSize = FVector2D(BrushSize, BrushSize);
-		break;
+		MaterialEntry->bHasThumbnail = true;
+	} else {
+		/* Streamed materials only get loaded once shown, see RequestThumbnail */
+		MaterialEntry->Brush = PlaceholderBrush;
 	}
-	MaterialEntry->Material = Material;
+	MaterialEntry->Brush.ImageSize = FVector2D(BrushSize, BrushSize);
 	return MaterialEntry;
 }
 
+void ATh3SMBuilderSubsystem::RequestThumbnail(UMaterialEntry* Entry, int32 Priority)
+{
+	if (not IsValid(Entry) or Entry->bHasThumbnail or IsNetMode(NM_DedicatedServer)) {
+		return;
+	}
+	/* Requesting again is how the picker bumps priorities, the request it replaces gets skipped */
+	if (Entry->bThumbnailQueued and Priority <= Entry->QueuedPriority) {
+		return;
+	}
+	Entry->bThumbnailQueued = true;
+	Entry->QueuedPriority = Priority;
+	Entry->QueuedSequence = ThumbnailSequence++;
+	ThumbnailQueue.HeapPush(FThumbnailRequest{ Priority, Entry->QueuedSequence, Entry });
+	SetActorTickEnabled(true);
+}
+
+ASMBuilderPhotoBooth* ATh3SMBuilderSubsystem::GetPhotoBooth()
+{
+	if (not PhotoBooth) {
+		PhotoBooth = Cast<ASMBuilderPhotoBooth>(GetWorld()->SpawnActor(PhotoBoothClass.Get()));
+		if (not PhotoBooth) {
+			UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Got nullptr PhotoBooth"));
+		}
+	}
+	return PhotoBooth;
+}
+
+void ATh3SMBuilderSubsystem::RenderThumbnail(UMaterialEntry* MaterialEntry)
+{
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_RenderThumbnail);
+	UMaterialInterface* Material = MaterialEntry->LoadMaterial();
+	bool bReady = true;
+	if (not Material) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not load material %s"), *MaterialEntry->MaterialPtr.ToString());
+	} else if (MaterialEntry->Domain != MD_Surface) {
+		/* Not a surface, so the material itself can be drawn as a brush */
+		MaterialEntry->Brush.SetResourceObject(Material);
+		MaterialEntry->Brush.ImageSize = FVector2D(BrushSize, BrushSize);
+	} else {
+		bReady = RenderSurfaceThumbnail(MaterialEntry, Material);
+	}
+	/* Keep the placeholder if there is no way to render, instead of retrying forever */
+	MaterialEntry->bHasThumbnail = true;
+	if (bReady) {
+		MaterialEntry->OnThumbnailReady.Broadcast(MaterialEntry);
+	}
+}
+
+bool ATh3SMBuilderSubsystem::RenderSurfaceThumbnail(UMaterialEntry* MaterialEntry, UMaterialInterface* Material)
+{
+	const FString MaterialPath = Material->GetPathName();
+	const uint32 ContentHash = bCacheThumbnails ? FTh3ThumbnailCache::HashMaterial(Material) : 0;
+	if (not bCacheThumbnails) {
+		RenderBoothThumbnail(MaterialEntry, Material, MaterialPath, ContentHash);
+		return true;
+	}
+	/* The brush keeps the placeholder until the cached thumbnail has been read */
+	const TWeakObjectPtr<UMaterialEntry> WeakEntry = MaterialEntry;
+	const bool bLoading = ThumbnailCache.Load(MaterialPath, ContentHash, [this, WeakEntry, MaterialPath, ContentHash](UTexture2D* Cached) {
+		UMaterialEntry* Entry = WeakEntry.Get();
+		if (not Entry) {
+			return;
+		}
+		if (Cached) {
+			Entry->Brush.SetResourceObject(Cached);
+			Entry->Brush.ImageSize = FVector2D(BrushSize, BrushSize);
+			INC_DWORD_STAT(STAT_Th3_NumThumbnailsCached);
+		} else if (UMaterialInterface* Material = Entry->LoadMaterial()) {
+			RenderBoothThumbnail(Entry, Material, MaterialPath, ContentHash);
+		}
+		Entry->OnThumbnailReady.Broadcast(Entry);
+	});
+	if (not bLoading) {
+		RenderBoothThumbnail(MaterialEntry, Material, MaterialPath, ContentHash);
+	}
+	return not bLoading;
+}
+
+void ATh3SMBuilderSubsystem::RenderBoothThumbnail(UMaterialEntry* MaterialEntry, UMaterialInterface* Material, const FString& MaterialPath, const uint32 ContentHash)
+{
+	ASMBuilderPhotoBooth* Booth = GetPhotoBooth();
+	if (not Booth) {
+		return;
+	}
+	MaterialEntry->Brush = Booth->RenderSurfaceMaterial(Material, BrushSize);
+	INC_DWORD_STAT(STAT_Th3_NumThumbnailsRendered);
+	if (bCacheThumbnails) {
+		ThumbnailCache.Store(MaterialPath, ContentHash, Cast<UTextureRenderTarget2D>(MaterialEntry->Brush.GetResourceObject()));
+	}
+}
+
+void ATh3SMBuilderSubsystem::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	const double Deadline = FPlatformTime::Seconds() + ThumbnailBudgetMs / 1000.0;
+	while (not ThumbnailQueue.IsEmpty()) {
+		FThumbnailRequest Request;
+		ThumbnailQueue.HeapPop(Request, false);
+		UMaterialEntry* Entry = Request.Entry.Get();
+		if (not Entry or Entry->QueuedSequence != Request.Sequence) {
+			continue;
+		}
+		Entry->bThumbnailQueued = false;
+		if (Entry->bHasThumbnail) {
+			continue;
+		}
+		RenderThumbnail(Entry);
+		if (FPlatformTime::Seconds() >= Deadline) {
+			break;
+		}
+	}
+	ThumbnailCache.Tick();
+	if (ThumbnailQueue.IsEmpty() and not ThumbnailCache.HasPendingWork()) {
+		if (bRenderingAllThumbnails) {
+			UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Done rendering thumbnails"));
+			bRenderingAllThumbnails = false;
+			bEntriesReady = true;
+		}
+		SetActorTickEnabled(false);
+	}
+}
+
 void ATh3SMBuilderSubsystem::BeginPlay()
 {
 	Super::BeginPlay();
 
-	TArray<UMaterialInterface*> MaterialInterfaces = GetMaterials();
+	const UTh3SMBuilderRootInstance* RootInstance = UTh3SMBuilderRootInstance::Get(this);
+	if (RootInstance and RootInstance->IsHeadlessServer()) {
+		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Dedicated server, not making material entries"));
+		bEntriesReady = true;
+		return;
+	}
+	if (not GIsEditor and RootInstance and not RootInstance->bMaterialsReady) {
+		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Materials still being discovered, waiting"));
+		GetWorldTimerManager().SetTimer(MaterialsReadyTimer, this, &ATh3SMBuilderSubsystem::MakeMaterialEntries, 0.5f, true);
+		return;
+	}
+	MakeMaterialEntries();
+}
+
+void ATh3SMBuilderSubsystem::MakeMaterialEntries()
+{
+	const UTh3SMBuilderRootInstance* RootInstance = UTh3SMBuilderRootInstance::Get(this);
+	if (not GIsEditor and RootInstance and not RootInstance->bMaterialsReady) {
+		return;
+	}
+	GetWorldTimerManager().ClearTimer(MaterialsReadyTimer);
+
+	TArray<FTh3MaterialInfo> MaterialInfos = GetMaterialInfos();
 
-	if (MaterialInterfaces.IsEmpty()) {
+	if (MaterialInfos.IsEmpty()) {
 		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("No materials to process"));
 		return;
 	}
-	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Sorting %d materials..."), MaterialInterfaces.Num());
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Sorting %d materials..."), MaterialInfos.Num());
 
-	Algo::Sort(MaterialInterfaces, [](const UMaterialInterface* A, const UMaterialInterface* B) {
-		return A->GetFName().Compare(B->GetFName()) < 0;
+	/* Sorted by asset name, which does not need the materials to be loaded */
+	Algo::Sort(MaterialInfos, [](const FTh3MaterialInfo& A, const FTh3MaterialInfo& B) {
+		return A.Material.GetAssetName() < B.Material.GetAssetName();
 	});
 
-	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Processing %d materials..."), MaterialInterfaces.Num());
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Processing %d materials..."), MaterialInfos.Num());
 
-	ASMBuilderPhotoBooth* PhotoBooth = Cast<ASMBuilderPhotoBooth>(GetWorld()->SpawnActor(PhotoBoothClass.Get()));
-	if (not PhotoBooth) {
-		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Got nullptr PhotoBooth"));
-		return;
-	}
-	for (UMaterialInterface* Material : MaterialInterfaces) {
-		MaterialEntries.Add(Material, MakeMaterialEntry(Material, PhotoBooth));
+	/* Without streaming, every material is loaded and kept by the root instance anyway */
+	const bool bStreaming = IsStreamingMaterials();
+	IndexedEntries.Reset(MaterialInfos.Num());
+	for (const FTh3MaterialInfo& Info : MaterialInfos) {
+		UMaterialInterface* Material = bStreaming ? nullptr : Info.Material.Get();
+		UMaterialEntry* MaterialEntry = MakeMaterialEntry(Info, Material);
+		if (Material) {
+			MaterialEntries.Add(Material, MaterialEntry);
+		} else {
+			StreamedEntries.Add(Info.Material.ToSoftObjectPath(), MaterialEntry);
+		}
+		IndexedEntries.Add(MaterialEntry);
 	}
 	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Done processing materials"));
+	BuildSearchIndex();
+	if (bCacheThumbnails) {
+		ThumbnailCache.Open(BrushSize);
+	}
 
+	/* Pickers that read Brush right away only get entries once every thumbnail is there */
+	if (not bRenderThumbnailsOnDemand and not bStreaming) {
+		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Rendering thumbnails..."));
+		bRenderingAllThumbnails = true;
+		for (UMaterialEntry* Entry : IndexedEntries) {
+			RequestThumbnail(Entry);
+		}
+		SetActorTickEnabled(true);
+		return;
+	}
 	bEntriesReady = true;
-	PhotoBooth->Destroy();
+}
+
+void ATh3SMBuilderSubsystem::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorldTimerManager().ClearTimer(MaterialsReadyTimer);
+	for (const FThumbnailRequest& Request : ThumbnailQueue) {
+		if (UMaterialEntry* Entry = Request.Entry.Get()) {
+			Entry->bThumbnailQueued = false;
+		}
+	}
+	ThumbnailQueue.Empty();
+	ThumbnailCache.Close();
+	if (PhotoBooth) {
+		PhotoBooth->Destroy();
+		PhotoBooth = nullptr;
+	}
+	Super::EndPlay(EndPlayReason);
 }
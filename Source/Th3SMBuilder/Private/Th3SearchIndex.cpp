@@ -0,0 +1,316 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3SearchIndex.h"
+
+#include "Algo/AllOf.h"
+#include "Algo/AnyOf.h"
+#include "Algo/NoneOf.h"
+#include "Algo/Sort.h"
+#include "Algo/Transform.h"
+
+FTh3SearchQuery FTh3SearchQuery::Parse(const FString& Query)
+{
+	FTh3SearchQuery Result;
+	TArray<FString> Terms;
+	Query.ToLower().ParseIntoArrayWS(Terms);
+	for (FString& Term : Terms) {
+		TArray<FString>* Target = &Result.Words;
+		if (Term.RemoveFromStart(TEXT("-"))) {
+			Target = &Result.Excluded;
+		} else if (Term.RemoveFromStart(TEXT("path:"))) {
+			Target = &Result.PathFilters;
+		} else if (Term.RemoveFromStart(TEXT("domain:"))) {
+			Target = &Result.DomainFilters;
+		} else if (Term.RemoveFromStart(TEXT("mod:"))) {
+			Target = &Result.ModFilters;
+		}
+		if (not Term.IsEmpty()) {
+			Target->Add(MoveTemp(Term));
+		}
+	}
+	return Result;
+}
+
+void FTh3SearchIndex::Reset()
+{
+	Texts.Reset();
+	Docs.Reset();
+	Tags.Reset();
+	Postings.Reset();
+}
+
+int32 FTh3SearchIndex::Add(const FString& Text, const FString& Tag)
+{
+	const int32 Id = Texts.Add(Text.ToLower());
+	const FString& Lower = Texts[Id];
+
+	FDocInfo& Doc = Docs.AddDefaulted_GetRef();
+	Doc.ModEnd = Lower.Find(TEXT("/"), ESearchCase::CaseSensitive, ESearchDir::FromStart, 1);
+	Doc.ModEnd = Doc.ModEnd == INDEX_NONE ? Lower.Len() : Doc.ModEnd;
+	int32 LastSlash = INDEX_NONE;
+	Doc.NameStart = Lower.FindLastChar(TEXT('/'), LastSlash) ? LastSlash + 1 : 0;
+	Doc.Tag = Tags.AddUnique(Tag.ToLower());
+
+	for (int32 Idx = 0; Idx + 3 <= Lower.Len(); Idx++) {
+		TArray<int32>& Posting = Postings.FindOrAdd(MakeTrigram(&Lower[Idx]));
+		/* Ids only grow, so checking the last one is enough to keep lists unique */
+		if (Posting.IsEmpty() or Posting.Last() != Id) {
+			Posting.Add(Id);
+		}
+	}
+	return Id;
+}
+
+SIZE_T FTh3SearchIndex::GetAllocatedSize() const
+{
+	SIZE_T Size = Texts.GetAllocatedSize() + Docs.GetAllocatedSize() + Tags.GetAllocatedSize() + Postings.GetAllocatedSize();
+	for (const FString& Text : Texts) {
+		Size += Text.GetAllocatedSize();
+	}
+	for (const TPair<FTrigram, TArray<int32>>& Posting : Postings) {
+		Size += Posting.Value.GetAllocatedSize();
+	}
+	return Size;
+}
+
+void FTh3SearchIndex::ToLowerWords(const TArray<FString>& Words, TArray<FString>& out_LowerWords)
+{
+	Algo::Transform(Words, out_LowerWords, [](const FString& Word) { return Word.ToLower(); });
+}
+
+static void IntersectSorted(TConstArrayView<int32> A, TConstArrayView<int32> B, TArray<int32>& out_Result)
+{
+	out_Result.Reset();
+	int32 IdxA = 0;
+	int32 IdxB = 0;
+	while (IdxA < A.Num() and IdxB < B.Num()) {
+		if (A[IdxA] < B[IdxB]) {
+			IdxA++;
+		} else if (B[IdxB] < A[IdxA]) {
+			IdxB++;
+		} else {
+			out_Result.Add(A[IdxA]);
+			IdxA++;
+			IdxB++;
+		}
+	}
+}
+
+void FTh3SearchIndex::Query(const TArray<FString>& Words, TArray<int32>& out_Ids) const
+{
+	TArray<FString> LowerWords;
+	ToLowerWords(Words, LowerWords);
+
+	TArray<const TArray<int32>*, TInlineAllocator<16>> Lists;
+	for (const FString& Word : LowerWords) {
+		for (int32 Idx = 0; Idx + 3 <= Word.Len(); Idx++) {
+			const TArray<int32>* Posting = Postings.Find(MakeTrigram(&Word[Idx]));
+			if (not Posting) {
+				/* Nothing contains this trigram, so nothing can match */
+				return;
+			}
+			Lists.AddUnique(Posting);
+		}
+	}
+
+	if (Lists.IsEmpty()) {
+		/* Only short words, check every string */
+		TArray<int32> AllIds;
+		AllIds.Reserve(Texts.Num());
+		for (int32 Id = 0; Id < Texts.Num(); Id++) {
+			AllIds.Add(Id);
+		}
+		Filter(AllIds, LowerWords, out_Ids);
+		return;
+	}
+
+	Algo::Sort(Lists, [](const TArray<int32>* A, const TArray<int32>* B) { return A->Num() < B->Num(); });
+	TArray<int32> Candidates = *Lists[0];
+	TArray<int32> Scratch;
+	for (int32 Idx = 1; Idx < Lists.Num() and not Candidates.IsEmpty(); Idx++) {
+		IntersectSorted(Candidates, *Lists[Idx], Scratch);
+		Swap(Candidates, Scratch);
+	}
+	/* Having all trigrams of a word does not mean containing the word itself */
+	Filter(Candidates, LowerWords, out_Ids);
+}
+
+void FTh3SearchIndex::Filter(TConstArrayView<int32> Candidates, const TArray<FString>& LowerWords, TArray<int32>& out_Ids) const
+{
+	for (const int32 Id : Candidates) {
+		const FString& Text = Texts[Id];
+		if (Algo::AllOf(LowerWords, [&Text](const FString& Word) { return Text.Contains(Word, ESearchCase::CaseSensitive); })) {
+			out_Ids.Add(Id);
+		}
+	}
+}
+
+/* Like Contains, but the match has to lie within [Start, End) */
+static bool ContainsWithin(const FString& Text, const FString& Word, const int32 Start, const int32 End)
+{
+	const int32 Pos = Text.Find(Word, ESearchCase::CaseSensitive, ESearchDir::FromStart, Start);
+	return Pos != INDEX_NONE and Pos + Word.Len() <= End;
+}
+
+static FORCEINLINE bool IsWordBoundary(const FString& Text, const int32 Pos)
+{
+	if (Pos == 0) {
+		return true;
+	}
+	const TCHAR Prev = Text[Pos - 1];
+	return Prev == TEXT('/') or Prev == TEXT('_') or Prev == TEXT('.') or Prev == TEXT(' ') or Prev == TEXT('-');
+}
+
+/* Greedy subsequence match, returns the number of characters spanned or 0 */
+static int32 FuzzySpan(const FString& Text, const FString& Word)
+{
+	int32 First = INDEX_NONE;
+	int32 WordIdx = 0;
+	for (int32 Idx = 0; Idx < Text.Len() and WordIdx < Word.Len(); Idx++) {
+		if (Text[Idx] == Word[WordIdx]) {
+			First = First == INDEX_NONE ? Idx : First;
+			if (++WordIdx == Word.Len()) {
+				return Idx - First + 1;
+			}
+		}
+	}
+	return 0;
+}
+
+bool FTh3SearchIndex::PassesFilters(const int32 Id, const FTh3SearchQuery& SearchQuery) const
+{
+	const FString& Text = Texts[Id];
+	const FDocInfo& Doc = Docs[Id];
+	const FString& Tag = Tags[Doc.Tag];
+	const auto contained = [&Text](const FString& Word) { return Text.Contains(Word, ESearchCase::CaseSensitive); };
+	const auto in_tag = [&Tag](const FString& Word) { return Tag.Contains(Word, ESearchCase::CaseSensitive); };
+	const auto in_mod = [&Text, &Doc](const FString& Word) { return ContainsWithin(Text, Word, 1, Doc.ModEnd); };
+	if (Algo::AnyOf(SearchQuery.Excluded, contained)) {
+		return false;
+	}
+	if (not Algo::AllOf(SearchQuery.PathFilters, contained)) {
+		return false;
+	}
+	if (not SearchQuery.DomainFilters.IsEmpty() and Algo::NoneOf(SearchQuery.DomainFilters, in_tag)) {
+		return false;
+	}
+	if (not SearchQuery.ModFilters.IsEmpty() and Algo::NoneOf(SearchQuery.ModFilters, in_mod)) {
+		return false;
+	}
+	return true;
+}
+
+float FTh3SearchIndex::ScoreExact(const int32 Id, const TArray<FString>& Words) const
+{
+	const FString& Text = Texts[Id];
+	const FDocInfo& Doc = Docs[Id];
+	/* Shorter paths are more likely what the user meant */
+	float Score = -0.01f * Text.Len();
+	for (const FString& Word : Words) {
+		/* Prefer a match in the asset name over one in the folders */
+		const int32 NamePos = Text.Find(Word, ESearchCase::CaseSensitive, ESearchDir::FromStart, Doc.NameStart);
+		const int32 Pos = NamePos != INDEX_NONE ? NamePos : Text.Find(Word, ESearchCase::CaseSensitive);
+		Score += 100.0f;
+		Score += NamePos != INDEX_NONE ? 50.0f : 0.0f;
+		Score += IsWordBoundary(Text, Pos) ? 25.0f : 0.0f;
+	}
+	return Score;
+}
+
+float FTh3SearchIndex::ScoreFuzzy(const int32 Id, const TArray<FString>& Words) const
+{
+	const FString& Text = Texts[Id];
+	float Score = -0.01f * Text.Len();
+	for (const FString& Word : Words) {
+		const int32 Span = FuzzySpan(Text, Word);
+		if (Span == 0) {
+			return -1.0f;
+		}
+		/* Always below an exact match, higher when the characters are close together */
+		Score += 10.0f + 10.0f * Word.Len() / Span;
+	}
+	return Score;
+}
+
+void FTh3SearchIndex::Search(const FTh3SearchQuery& SearchQuery, const int32 MaxResults, TArray<int32>& out_Ids) const
+{
+	if (MaxResults <= 0) {
+		return;
+	}
+
+	/* Min-heap on score, holding the best MaxResults so far */
+	using FScored = TPair<float, int32>;
+	const auto worse = [](const FScored& A, const FScored& B) {
+		return A.Key < B.Key or (A.Key == B.Key and A.Value > B.Value);
+	};
+	TArray<FScored> Heap;
+	Heap.Reserve(MaxResults + 1);
+	const auto consider = [&Heap, &worse, MaxResults](const int32 Id, const float Score) {
+		if (Heap.Num() < MaxResults) {
+			Heap.HeapPush(FScored(Score, Id), worse);
+		} else if (worse(Heap.HeapTop(), FScored(Score, Id))) {
+			Heap.HeapPopDiscard(worse, false);
+			Heap.HeapPush(FScored(Score, Id), worse);
+		}
+	};
+
+	TArray<FString> Required = SearchQuery.PathFilters;
+	Required.Append(SearchQuery.Words);
+	TArray<int32> Exact;
+	if (Required.IsEmpty()) {
+		Exact.Reserve(Texts.Num());
+		for (int32 Id = 0; Id < Texts.Num(); Id++) {
+			Exact.Add(Id);
+		}
+	} else {
+		Query(Required, Exact);
+	}
+
+	TBitArray<> Seen(false, Texts.Num());
+	for (const int32 Id : Exact) {
+		Seen[Id] = true;
+		if (PassesFilters(Id, SearchQuery)) {
+			consider(Id, ScoreExact(Id, SearchQuery.Words));
+		}
+	}
+
+	if (Heap.IsEmpty() and not SearchQuery.Words.IsEmpty()) {
+		/* Scoring every string is slow, so only do it when nothing matched exactly */
+		for (int32 Id = 0; Id < Texts.Num(); Id++) {
+			if (Seen[Id] or not PassesFilters(Id, SearchQuery)) {
+				continue;
+			}
+			const float Score = ScoreFuzzy(Id, SearchQuery.Words);
+			if (Score >= 0.0f) {
+				consider(Id, Score);
+			}
+		}
+	}
+
+	Heap.Sort([&worse](const FScored& A, const FScored& B) { return worse(B, A); });
+	Algo::Transform(Heap, out_Ids, [](const FScored& Scored) { return Scored.Value; });
+}
+
+/* True if everything matching the new words also matched the old ones */
+static bool IsRefinementOf(const TArray<FString>& NewWords, const TArray<FString>& OldWords)
+{
+	return Algo::AllOf(OldWords, [&NewWords](const FString& OldWord) {
+		return Algo::AnyOf(NewWords, [&OldWord](const FString& NewWord) { return NewWord.Contains(OldWord, ESearchCase::CaseSensitive); });
+	});
+}
+
+const TArray<int32>& FTh3IncrementalSearch::Search(const FTh3SearchIndex& Index, const TArray<FString>& Words)
+{
+	TArray<FString> LowerWords;
+	FTh3SearchIndex::ToLowerWords(Words, LowerWords);
+	TArray<int32> Ids;
+	if (bHasLast and IsRefinementOf(LowerWords, LastWords)) {
+		Index.Filter(LastIds, LowerWords, Ids);
+	} else {
+		Index.Query(LowerWords, Ids);
+	}
+	LastWords = MoveTemp(LowerWords);
+	LastIds = MoveTemp(Ids);
+	bHasLast = true;
+	return LastIds;
+}
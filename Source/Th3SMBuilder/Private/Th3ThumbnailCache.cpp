@@ -0,0 +1,298 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3ThumbnailCache.h"
+#include "Th3SMBuilder.h"
+#include "Th3DiscoveryManifest.h"
+
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Async/AsyncFileHandle.h"
+#include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "TextureResource.h"
+
+static constexpr uint32 THUMBNAIL_CACHE_MAGIC = 0x43543354; /* "T3TC" */
+static constexpr uint32 THUMBNAIL_CACHE_VERSION = 1;
+
+FTh3ThumbnailCache::~FTh3ThumbnailCache()
+{
+	Close();
+}
+
+FString FTh3ThumbnailCache::GetIndexPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("Th3SMBuilder") / TEXT("Thumbnails.idx");
+}
+
+FString FTh3ThumbnailCache::GetPackPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("Th3SMBuilder") / TEXT("Thumbnails.dat");
+}
+
+uint32 FTh3ThumbnailCache::HashMaterial(const UMaterialInterface* Material)
+{
+	const FString PackageName = Material->GetPackage()->GetName();
+	FString Filename;
+	if (not FPackageName::DoesPackageExist(PackageName, &Filename)) {
+		/* Made at runtime, nothing to tell whether it changed */
+		return 0;
+	}
+	uint32 Hash = GetTypeHash(Material->GetPathName());
+	/* Usually only there in the editor */
+	const TOptional<FAssetPackageData> PackageData = IAssetRegistry::Get()->GetAssetPackageDataCopy(Material->GetPackage()->GetFName());
+	if (PackageData) {
+		Hash = HashCombine(Hash, GetTypeHash(PackageData->GetPackageSavedHash()));
+		Hash = HashCombine(Hash, GetTypeHash(PackageData->DiskSize));
+	}
+	/* Only valid for loose files, cooked packages inside containers have no stat data of their own */
+	const FFileStatData StatData = IFileManager::Get().GetStatData(*Filename);
+	if (StatData.bIsValid) {
+		Hash = HashCombine(Hash, GetTypeHash(StatData.FileSize));
+		Hash = HashCombine(Hash, GetTypeHash(StatData.ModificationTime));
+	}
+	/* Changes with the game build or the version of the mod the material comes from */
+	Hash = HashCombine(Hash, FTh3DiscoveryManifest::HashMountRoot(FTh3DiscoveryManifest::GetMountRoot(PackageName)));
+	return FMath::Max(Hash, 1u);
+}
+
+void FTh3ThumbnailCache::Reset()
+{
+	Entries.Empty();
+	ReadHandle.Reset();
+	PackFile.Reset();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.DeleteFile(*GetIndexPath());
+	PlatformFile.DeleteFile(*GetPackPath());
+}
+
+bool FTh3ThumbnailCache::ReadIndex()
+{
+	TArray<uint8> IndexData;
+	if (not FFileHelper::LoadFileToArray(IndexData, *GetIndexPath(), FILEREAD_Silent)) {
+		return false;
+	}
+	FMemoryReader Reader(IndexData);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	int32 IndexSize = 0;
+	Reader << Magic;
+	Reader << Version;
+	Reader << IndexSize;
+	if (Magic != THUMBNAIL_CACHE_MAGIC or Version != THUMBNAIL_CACHE_VERSION or IndexSize != Size) {
+		return false;
+	}
+	Reader << Entries;
+	return not Reader.IsError();
+}
+
+void FTh3ThumbnailCache::Open(const int32 InSize)
+{
+	Close();
+	Size = InSize;
+	if (not ReadIndex()) {
+		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Starting a new thumbnail cache"));
+		Reset();
+	}
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(GetPackPath()));
+	if (not OpenFiles()) {
+		return;
+	}
+
+	/* Stale thumbnails are never removed from the pack, start over once most of it is garbage */
+	int64 LiveBytes = 0;
+	for (const TPair<FString, FEntry>& Pair : Entries) {
+		LiveBytes += Pair.Value.CompressedSize;
+	}
+	if (PackFile->Size() > 2 * LiveBytes + 1024 * 1024) {
+		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Compacting thumbnail cache by starting over"));
+		Reset();
+		OpenFiles();
+	}
+	UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Opened thumbnail cache with %d entries"), Entries.Num());
+}
+
+bool FTh3ThumbnailCache::OpenFiles()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PackFile.Reset(PlatformFile.OpenWrite(*GetPackPath(), true, true));
+	/* Allows writing, as the pack stays open for appending at the same time */
+	ReadHandle.Reset(PackFile ? PlatformFile.OpenAsyncRead(*GetPackPath(), true) : nullptr);
+	if (not PackFile or not ReadHandle) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not open thumbnail cache %s"), *GetPackPath());
+		Entries.Empty();
+		ReadHandle.Reset();
+		PackFile.Reset();
+		return false;
+	}
+	return true;
+}
+
+void FTh3ThumbnailCache::Close()
+{
+	/* Requests have to be gone before their file handle */
+	for (const TSharedRef<FPendingLoad, ESPMode::ThreadSafe>& Load : PendingLoads) {
+		Load->Request->WaitCompletion();
+		delete Load->Request;
+	}
+	PendingLoads.Empty();
+	for (const TSharedRef<FPendingStore, ESPMode::ThreadSafe>& Store : PendingStores) {
+		Store->Fence.Wait();
+		FinishStore(*Store);
+	}
+	PendingStores.Empty();
+	ReadHandle.Reset();
+	if (PackFile) {
+		PackFile->Flush();
+		PackFile.Reset();
+	}
+	if (not bDirty) {
+		return;
+	}
+	TArray<uint8> IndexData;
+	FMemoryWriter Writer(IndexData);
+	uint32 Magic = THUMBNAIL_CACHE_MAGIC;
+	uint32 Version = THUMBNAIL_CACHE_VERSION;
+	Writer << Magic;
+	Writer << Version;
+	Writer << Size;
+	Writer << Entries;
+	if (not FFileHelper::SaveArrayToFile(IndexData, *GetIndexPath())) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not write thumbnail cache index %s"), *GetIndexPath());
+	}
+	bDirty = false;
+}
+
+bool FTh3ThumbnailCache::Load(const FString& MaterialPath, const uint32 ContentHash, FOnLoaded OnLoaded)
+{
+	const FEntry* Entry = Entries.Find(MaterialPath);
+	if (not ReadHandle or ContentHash == 0 or not Entry or Entry->ContentHash != ContentHash) {
+		return false;
+	}
+	TSharedRef<FPendingLoad, ESPMode::ThreadSafe> Load = MakeShared<FPendingLoad, ESPMode::ThreadSafe>();
+	Load->Entry = *Entry;
+	Load->OnLoaded = MoveTemp(OnLoaded);
+
+	/* Runs on an IO thread, so the game thread only has to make the texture */
+	FAsyncFileCallBack Callback = [Load](bool bWasCancelled, IAsyncReadRequest* Request) {
+		uint8* Compressed = bWasCancelled ? nullptr : Request->GetReadResults();
+		if (Compressed) {
+			Load->Pixels.SetNumUninitialized(Load->Entry.Width * Load->Entry.Height);
+			const int32 RawSize = Load->Pixels.Num() * Load->Pixels.GetTypeSize();
+			Load->bSucceeded = FCompression::UncompressMemory(NAME_Zlib, Load->Pixels.GetData(), RawSize, Compressed, Load->Entry.CompressedSize);
+			FMemory::Free(Compressed);
+		}
+		Load->bDone = true;
+	};
+	Load->Request = ReadHandle->ReadRequest(Entry->Offset, Entry->CompressedSize, AIOP_Normal, &Callback);
+	if (not Load->Request) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not read cached thumbnail for %s"), *MaterialPath);
+		return false;
+	}
+	PendingLoads.Add(Load);
+	return true;
+}
+
+UTexture2D* FTh3ThumbnailCache::MakeTexture(const FPendingLoad& Load)
+{
+	UTexture2D* Texture = UTexture2D::CreateTransient(Load.Entry.Width, Load.Entry.Height, PF_B8G8R8A8);
+	if (not Texture) {
+		return nullptr;
+	}
+	const int32 RawSize = Load.Pixels.Num() * Load.Pixels.GetTypeSize();
+	FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[0];
+	FMemory::Memcpy(Mip.BulkData.Lock(LOCK_READ_WRITE), Load.Pixels.GetData(), RawSize);
+	Mip.BulkData.Unlock();
+	Texture->UpdateResource();
+	return Texture;
+}
+
+bool FTh3ThumbnailCache::Store(const FString& MaterialPath, const uint32 ContentHash, UTextureRenderTarget2D* RenderTarget)
+{
+	if (not PackFile or not RenderTarget or ContentHash == 0) {
+		return false;
+	}
+	FTextureRenderTargetResource* Resource = RenderTarget->GameThread_GetRenderTargetResource();
+	if (not Resource) {
+		return false;
+	}
+	TSharedRef<FPendingStore, ESPMode::ThreadSafe> Store = MakeShared<FPendingStore, ESPMode::ThreadSafe>();
+	Store->MaterialPath = MaterialPath;
+	Store->Entry.ContentHash = ContentHash;
+	Store->Entry.Width = RenderTarget->SizeX;
+	Store->Entry.Height = RenderTarget->SizeY;
+	/* Same as ReadPixels, but on the render thread instead of flushing it from the game thread */
+	ENQUEUE_RENDER_COMMAND(Th3ReadThumbnail)([Resource, Store](FRHICommandListImmediate& RHICmdList) {
+		const FIntRect Rect(0, 0, Store->Entry.Width, Store->Entry.Height);
+		RHICmdList.ReadSurfaceData(Resource->GetRenderTargetTexture(), Rect, Store->Pixels, FReadSurfaceDataFlags());
+	});
+	Store->Fence.BeginFence();
+	PendingStores.Add(Store);
+	return true;
+}
+
+void FTh3ThumbnailCache::FinishStore(FPendingStore& Store)
+{
+	if (not PackFile or Store.Pixels.IsEmpty()) {
+		return;
+	}
+	const int32 RawSize = Store.Pixels.Num() * Store.Pixels.GetTypeSize();
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, RawSize);
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+	if (not FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Store.Pixels.GetData(), RawSize)) {
+		return;
+	}
+
+	FEntry Entry = Store.Entry;
+	Entry.CompressedSize = CompressedSize;
+	if (not PackFile->SeekFromEnd(0)) {
+		return;
+	}
+	Entry.Offset = PackFile->Tell();
+	if (not PackFile->Write(Compressed.GetData(), CompressedSize)) {
+		UE_LOG(LogTh3SMBuilderCpp, Error, TEXT("Could not write cached thumbnail for %s"), *Store.MaterialPath);
+		return;
+	}
+	Entries.Add(Store.MaterialPath, Entry);
+	bDirty = true;
+}
+
+void FTh3ThumbnailCache::Tick()
+{
+	/* Fences complete in order, so stores are written in the order they were made */
+	int32 NumStored = 0;
+	while (not PendingStores.IsEmpty() and PendingStores[0]->Fence.IsFenceComplete()) {
+		FinishStore(*PendingStores[0]);
+		PendingStores.RemoveAt(0);
+		NumStored++;
+	}
+	if (NumStored > 0 and PackFile) {
+		/* Reads go through another handle, which only sees what was flushed */
+		PackFile->Flush();
+	}
+
+	for (int32 Idx = 0; Idx < PendingLoads.Num();) {
+		const TSharedRef<FPendingLoad, ESPMode::ThreadSafe> Load = PendingLoads[Idx];
+		if (not Load->bDone) {
+			Idx++;
+			continue;
+		}
+		/* Done means the callback ran, this only waits for the request to let go of it */
+		Load->Request->WaitCompletion();
+		delete Load->Request;
+		Load->Request = nullptr;
+		PendingLoads.RemoveAtSwap(Idx);
+		/* May start new loads, which get added at the end */
+		Load->OnLoaded(Load->bSucceeded ? MakeTexture(*Load) : nullptr);
+	}
+}
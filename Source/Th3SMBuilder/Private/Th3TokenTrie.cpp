@@ -0,0 +1,161 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "Th3TokenTrie.h"
+
+#include "Algo/Sort.h"
+
+void FTh3TokenTrie::Reset()
+{
+	Pending.Reset();
+	Nodes.Reset();
+	PostingStarts.Reset();
+	Postings.Reset();
+}
+
+void FTh3TokenTrie::Add(const int32 DocId, const FString& Token)
+{
+	Pending.Emplace(Token.ToLower(), DocId);
+}
+
+void FTh3TokenTrie::Build()
+{
+	Algo::Sort(Pending, [](const TPair<FString, int32>& A, const TPair<FString, int32>& B) {
+		const int32 Order = A.Key.Compare(B.Key, ESearchCase::CaseSensitive);
+		return Order != 0 ? Order < 0 : A.Value < B.Value;
+	});
+	Nodes.Reset();
+	Nodes.AddDefaulted();
+	PostingStarts.Reset();
+	Postings.Reset();
+	Postings.Reserve(Pending.Num());
+
+	const FString* LastToken = nullptr;
+	for (const TPair<FString, int32>& Entry : Pending) {
+		if (LastToken and *LastToken == Entry.Key) {
+			/* Sorted by document too, so duplicates are next to each other */
+			if (Postings.Last() != Entry.Value) {
+				Postings.Add(Entry.Value);
+			}
+			continue;
+		}
+		LastToken = &Entry.Key;
+		const int32 TokenIdx = PostingStarts.Add(Postings.Num());
+		Postings.Add(Entry.Value);
+
+		/* Tokens come sorted, so an existing child for this character can only be the last one */
+		int32 Node = 0;
+		Nodes[Node].TokenEnd = TokenIdx + 1;
+		for (const TCHAR Char : Entry.Key) {
+			int32 Child = Nodes[Node].LastChild;
+			if (Child == INDEX_NONE or Nodes[Child].Char != Char) {
+				Child = Nodes.AddDefaulted();
+				Nodes[Child].Char = Char;
+				Nodes[Child].TokenBegin = TokenIdx;
+				if (Nodes[Node].LastChild == INDEX_NONE) {
+					Nodes[Node].FirstChild = Child;
+				} else {
+					Nodes[Nodes[Node].LastChild].NextSibling = Child;
+				}
+				Nodes[Node].LastChild = Child;
+			}
+			Node = Child;
+			Nodes[Node].TokenEnd = TokenIdx + 1;
+		}
+	}
+	PostingStarts.Add(Postings.Num());
+	Pending.Empty();
+	Nodes.Shrink();
+}
+
+void FTh3TokenTrie::FindPrefix(FStringView Prefix, TBitArray<>& out_Docs) const
+{
+	if (Nodes.IsEmpty()) {
+		return;
+	}
+	int32 Node = 0;
+	for (const TCHAR Char : Prefix) {
+		int32 Child = Nodes[Node].FirstChild;
+		while (Child != INDEX_NONE and Nodes[Child].Char != Char) {
+			Child = Nodes[Child].NextSibling;
+		}
+		if (Child == INDEX_NONE) {
+			return;
+		}
+		Node = Child;
+	}
+	for (int32 Token = Nodes[Node].TokenBegin; Token < Nodes[Node].TokenEnd; Token++) {
+		for (int32 Idx = PostingStarts[Token]; Idx < PostingStarts[Token + 1]; Idx++) {
+			out_Docs[Postings[Idx]] = true;
+		}
+	}
+}
+
+int32 FTh3TokenTrie::Search(const FString& Query, const int32 NumDocs, const int32 PageIndex, const int32 PageSize, TArray<int32>& out_DocIds) const
+{
+	out_DocIds.Reset();
+	TArray<FString> Words;
+	Query.ToLower().ParseIntoArrayWS(Words);
+
+	TBitArray<> Matches(true, NumDocs);
+	TBitArray<> WordMatches;
+	for (const FString& Word : Words) {
+		WordMatches.Init(false, NumDocs);
+		FindPrefix(Word, WordMatches);
+		Matches.CombineWithBitwiseAND(WordMatches, EBitwiseOperatorFlags::MinSize);
+	}
+
+	const int32 Size = FMath::Max(PageSize, 1);
+	const int32 First = FMath::Max(PageIndex, 0) * Size;
+	int32 NumMatches = 0;
+	for (TConstSetBitIterator<> It(Matches); It; ++It) {
+		if (NumMatches >= First and out_DocIds.Num() < Size) {
+			out_DocIds.Add(It.GetIndex());
+		}
+		NumMatches++;
+	}
+	return NumMatches;
+}
+
+void FTh3TokenTrie::Tokenize(FStringView Text, TArray<FString>& out_Tokens)
+{
+	const auto is_separator = [](const TCHAR Char) { return Char == TEXT('/') or Char == TEXT('.'); };
+	int32 Start = 0;
+	while (Start < Text.Len()) {
+		int32 End = Start;
+		while (End < Text.Len() and not is_separator(Text[End])) {
+			End++;
+		}
+		const FStringView Segment = Text.Mid(Start, End - Start);
+		Start = End + 1;
+		if (Segment.IsEmpty()) {
+			continue;
+		}
+		out_Tokens.Emplace(Segment);
+
+		/* "SM_RockLarge02" also gives "sm", "rock", "large" and "02" */
+		int32 WordStart = INDEX_NONE;
+		for (int32 Idx = 0; Idx <= Segment.Len(); Idx++) {
+			const bool bAtEnd = Idx == Segment.Len();
+			const TCHAR Char = bAtEnd ? 0 : Segment[Idx];
+			bool bBreak = bAtEnd or not FChar::IsAlnum(Char);
+			if (not bBreak and WordStart != INDEX_NONE) {
+				const TCHAR Prev = Segment[Idx - 1];
+				bBreak = (FChar::IsLower(Prev) and FChar::IsUpper(Char)) or (FChar::IsDigit(Prev) != FChar::IsDigit(Char));
+			}
+			if (bBreak and WordStart != INDEX_NONE) {
+				if (Idx - WordStart < Segment.Len()) {
+					out_Tokens.Emplace(Segment.Mid(WordStart, Idx - WordStart));
+				}
+				WordStart = INDEX_NONE;
+			}
+			if (not bAtEnd and FChar::IsAlnum(Char) and WordStart == INDEX_NONE) {
+				WordStart = Idx;
+			}
+		}
+	}
+}
+
+SIZE_T FTh3TokenTrie::GetAllocatedSize() const
+{
+	return Pending.GetAllocatedSize() + Nodes.GetAllocatedSize() + PostingStarts.GetAllocatedSize() + Postings.GetAllocatedSize();
+}
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: MPL-2.0 */
 
 #include "Th3Utilities.h"
+#include "Th3SMBuilderStats.h"
 
 #include "Algo/AnyOf.h"
 #include "Algo/NoneOf.h"
@@ -10,21 +11,95 @@
 #include "Logging/StructuredLog.h"
 #include "Reflection/ClassGenerator.h"
 
+#if PLATFORM_ENABLE_VECTORINTRINSICS && PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#define TH3_STRING_SSE2 1
+#else
+#define TH3_STRING_SSE2 0
+#endif
+
 DEFINE_LOG_CATEGORY(LogTh3Utilities);
 
+static FORCEINLINE TCHAR ToLowerAscii(const TCHAR Char)
+{
+	return (Char >= TEXT('A') and Char <= TEXT('Z')) ? Char + (TEXT('a') - TEXT('A')) : Char;
+}
+
+static FORCEINLINE bool MatchesLowerAt(const TCHAR* Haystack, const TCHAR* LowerNeedle, const int32 Len)
+{
+	for (int32 Idx = 0; Idx < Len; Idx++) {
+		if (ToLowerAscii(Haystack[Idx]) != LowerNeedle[Idx]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+#if TH3_STRING_SSE2
+static FORCEINLINE __m128i ToLowerAscii8(const __m128i Chars)
+{
+	const __m128i AboveA = _mm_cmpgt_epi16(Chars, _mm_set1_epi16(TEXT('A') - 1));
+	const __m128i BelowZ = _mm_cmplt_epi16(Chars, _mm_set1_epi16(TEXT('Z') + 1));
+	return _mm_add_epi16(Chars, _mm_and_si128(_mm_and_si128(AboveA, BelowZ), _mm_set1_epi16(TEXT('a') - TEXT('A'))));
+}
+#endif
+
+bool Th3Utilities::ContainsLowerAscii(FStringView Haystack, FStringView LowerNeedle)
+{
+	const int32 NeedleLen = LowerNeedle.Len();
+	if (NeedleLen == 0) {
+		return true;
+	}
+	const TCHAR* Hay = Haystack.GetData();
+	const TCHAR* Needle = LowerNeedle.GetData();
+	const int32 LastStart = Haystack.Len() - NeedleLen;
+	int32 Pos = 0;
+#if TH3_STRING_SSE2
+	if constexpr (sizeof(TCHAR) == sizeof(uint16)) {
+		/*
+		 * Compare the first and last needle characters against 8 start positions
+		 * at once, and only compare the whole needle where both of them match.
+		 */
+		const __m128i First = _mm_set1_epi16(Needle[0]);
+		const __m128i Last = _mm_set1_epi16(Needle[NeedleLen - 1]);
+		for (; Pos + 8 <= LastStart + 1; Pos += 8) {
+			const __m128i BlockFirst = ToLowerAscii8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Hay + Pos)));
+			const __m128i BlockLast = ToLowerAscii8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Hay + Pos + NeedleLen - 1)));
+			uint32 Mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(BlockFirst, First), _mm_cmpeq_epi16(BlockLast, Last)));
+			while (Mask) {
+				/* Two mask bits per character */
+				const uint32 Bit = FMath::CountTrailingZeros(Mask);
+				if (MatchesLowerAt(Hay + Pos + Bit / 2, Needle, NeedleLen)) {
+					return true;
+				}
+				Mask &= ~(3u << Bit);
+			}
+		}
+	}
+#endif
+	for (; Pos <= LastStart; Pos++) {
+		if (MatchesLowerAt(Hay + Pos, Needle, NeedleLen)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 UClass* Th3Utilities::GenerateNewClass(const FString& Package, const FString& Name, UClass* ParentClass)
 {
+	TH3_SCOPE_CYCLE_COUNTER(STAT_Th3_GenerateClass);
 	if (Name == "") {
 		UE_LOG(LogTh3Utilities, Fatal, TEXT("Name was empty, can't create class"));
 		return nullptr;
 	}
-	FTopLevelAssetPath Path = FTopLevelAssetPath(FString::Printf(TEXT("%s.%s"), *Package, *Name));
+	const FName PackageName(*Package);
+	FTopLevelAssetPath Path = FTopLevelAssetPath(PackageName, FName(*Name));
 	if (FindObject<UClass>(Path)) {
 		UE_LOG(LogTh3Utilities, Error, TEXT("Class for name %s already exists"), *Name);
 		UE_LOG(LogTh3Utilities, Fatal, TEXT("Found %s"), *Path.ToString());
 		return nullptr;
 	}
-	FTopLevelAssetPath Path_C = FTopLevelAssetPath(FString::Printf(TEXT("%s.%s_C"), *Package, *Name));
+	FTopLevelAssetPath Path_C = FTopLevelAssetPath(PackageName, FName(*(Name + TEXT("_C"))));
 	if (FindObject<UClass>(Path_C)) {
 		UE_LOG(LogTh3Utilities, Error, TEXT("Class for name %s already exists"), *Name);
 		UE_LOG(LogTh3Utilities, Fatal, TEXT("Found %s"), *Path_C.ToString());
@@ -4,17 +4,56 @@
 
 #include "CoreMinimal.h"
 #include "Styling/SlateBrush.h"
+#include "MaterialDomain.h"
 #include "Th3BuildableSM.h"
 #include "MaterialEntry.generated.h"
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnMaterialEntryThumbnailReady, UMaterialEntry*, Entry);
+
+/* What the material picker needs to know about a material that may not be loaded */
+USTRUCT(BlueprintType)
+struct TH3SMBUILDER_API FTh3MaterialInfo
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly)
+	TSoftObjectPtr<UMaterialInterface> Material;
+
+	UPROPERTY(BlueprintReadOnly)
+	TEnumAsByte<EMaterialDomain> Domain = MD_Surface;
+};
+
 UCLASS(BlueprintType)
 class TH3SMBUILDER_API UMaterialEntry : public UObject
 {
 	GENERATED_BODY()
 public:
+	/* Null for streamed materials until LoadMaterial is called */
 	UPROPERTY(BlueprintReadWrite)
 	UMaterialInterface* Material;
 
+	UPROPERTY(BlueprintReadOnly)
+	TSoftObjectPtr<UMaterialInterface> MaterialPtr;
+
+	UPROPERTY(BlueprintReadOnly)
+	TEnumAsByte<EMaterialDomain> Domain = MD_Surface;
+
 	UPROPERTY(BlueprintReadWrite)
 	FSlateBrush Brush;
+
+	/* Set once the thumbnail is rendered or being read from the cache, OnThumbnailReady fires when Brush changes */
+	UPROPERTY(BlueprintReadOnly)
+	bool bHasThumbnail = false;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnMaterialEntryThumbnailReady OnThumbnailReady;
+
+	/* Returns the material, loading it first if needed */
+	UFUNCTION(BlueprintCallable)
+	UMaterialInterface* LoadMaterial();
+
+	/* Newest request for this entry in the thumbnail queue, older ones are stale */
+	bool bThumbnailQueued = false;
+	int32 QueuedPriority = 0;
+	uint32 QueuedSequence = 0;
 };
@@ -14,8 +14,12 @@ public:
 	AStaticMeshHologram();
 
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual bool IsValidHitResult(const FHitResult& hitResult) const override;
 	virtual void SetHologramLocationAndRotation(const FHitResult& hitResult) override;
 	virtual float GetBuildGunRangeOverride_Implementation() const override;
+protected:
+	/* Mesh held in the mesh residency manager while previewing */
+	TSoftObjectPtr<UStaticMesh> HeldMesh;
 };
@@ -6,6 +6,18 @@
 #include "Buildables/FGBuildable.h"
 #include "Th3BuildableSM.generated.h"
 
+class UBoxComponent;
+class ATh3SMBuilderSavePalette;
+
+UENUM(BlueprintType)
+enum class ETh3CollisionPolicy : uint8
+{
+	/* Mesh collision, created as soon as the buildable is */
+	Full,
+	/* Bounding box collision, mesh collision only while players are nearby */
+	Proximity,
+};
+
 UCLASS()
 class TH3SMBUILDER_API ATh3BuildableSM : public AFGBuildable
 {
@@ -17,13 +29,59 @@ public:
 
 	void SetMesh(UStaticMesh* NewMesh);
 
+	/* Switches between mesh collision and bounding box collision */
+	void SetFullCollision(bool bFull);
+
+	/* World space box around the mesh, the same one used for bounding box collision */
+	FBox GetCollisionBounds() const;
+
+	/*
+	 * Loads the mesh if this buildable was generated without it, or if it got evicted.
+	 * Goes through the mesh residency manager of WorldContext (or this) when there is one.
+	 */
+	UStaticMesh* EnsureMeshLoaded(UObject* WorldContext = nullptr);
+
+	const TSoftObjectPtr<UStaticMesh>& GetMeshPtr() const
+	{
+		return MeshPtr;
+	}
+
+	const TArray<FSoftObjectPath>& GetMeshAliases() const
+	{
+		return MeshAliases;
+	}
+
+	/* See UTh3SMBuilderRootInstance::GetMeshInfo */
+	UFUNCTION(BlueprintPure)
+	int32 GetMeshId() const
+	{
+		return MeshId;
+	}
+
+	/* Clients also send it to the server, which loads the material by path if it is not loaded yet */
 	UFUNCTION(BlueprintCallable)
 	void SetMaterialForIndex(int32 Index, UMaterialInterface* Material);
 
+	int32 GetNumMaterialSlots() const;
+
 	UFUNCTION(BlueprintCallable)
 	FText GetSearchText() const;
 
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/* Called by the save palette before saving, moves materials and the search string into it */
+	void WriteToPalette(ATh3SMBuilderSavePalette& Palette);
+
+	/*
+	 * Begin IFGSaveInterface
+	 */
+	virtual void PostSaveGame_Implementation(int32 saveVersion, int32 gameVersion) override;
+	virtual void PostLoadGame_Implementation(int32 saveVersion, int32 gameVersion) override;
+	/*
+	 * End IFGSaveInterface
+	 */
 
 	/*
 	 * Begin IFGDismantleInterface
@@ -41,24 +99,85 @@ public:
 	}
 
 protected:
+	/* Draws the mesh through the instance manager when enabled, or the mesh component otherwise */
+	void UpdateInstance();
+
+	/*
+	 * Unregisters the mesh component while drawn as an instance, so that it has
+	 * no scene proxy or physics body, unless its collision is needed.
+	 */
+	void UpdateMeshRegistration();
+
+	/* Fits the bounding box collision to the mesh */
+	void UpdateBounds();
+
+	UFUNCTION()
+	void OnRep_OverriddenMaterials();
+
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
 	UMaterialInterface* FallbackMaterial;
 
+	/* Draw copies sharing a mesh and materials as instances of one component */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+	bool bUseInstancedRendering;
+
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
 	UStaticMesh* Mesh;
 
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+	TSoftObjectPtr<UStaticMesh> MeshPtr;
+
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+	int32 MeshId = INDEX_NONE;
+
+	/* Whether this buildable holds its mesh in the mesh residency manager */
+	bool bHoldsMesh = false;
+
+	/* Set by UpdateInstance and SetFullCollision, see UpdateMeshRegistration */
+	bool bDrawnAsInstance = false;
+	bool bFullCollision = false;
+
+	/* Other meshes with the same geometry, which got no buildable of their own */
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FSoftObjectPath> MeshAliases;
+
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
 	FCollisionProfileName CollisionProfile;
 
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	ETh3CollisionPolicy CollisionPolicy;
+
 	UPROPERTY(BlueprintReadWrite)
 	UStaticMeshComponent* MeshComponent;
 
+	/* Only collides while the mesh component does not */
+	UPROPERTY(BlueprintReadOnly)
+	UBoxComponent* BoundsComponent;
+
 	UPROPERTY(BlueprintReadWrite, SaveGame)
 	int32 MaterialSlotIndex;
 
 	UPROPERTY(BlueprintReadWrite, SaveGame)
 	FString SearchString;
 
-	UPROPERTY(BlueprintReadWrite, SaveGame)
+	UPROPERTY(BlueprintReadWrite, SaveGame, ReplicatedUsing = OnRep_OverriddenMaterials)
 	TArray<UMaterialInterface*> OverriddenMaterials;
+
+	/*
+	 * With a save palette, the two properties above are saved empty and
+	 * these refer to the palette instead. Materials are saved as pairs of
+	 * slot and palette index, only for slots that differ from the mesh.
+	 */
+	UPROPERTY(SaveGame)
+	TArray<int32> SavedMaterialDeltas;
+
+	UPROPERTY(SaveGame)
+	int32 SavedSearchString = INDEX_NONE;
+
+	/* Put back after saving */
+	TArray<UMaterialInterface*> StashedMaterials;
+	FString StashedSearchString;
+
+	/* Read from the palette, applied once the mesh is there in BeginPlay */
+	TArray<TPair<int32, UMaterialInterface*>> PendingMaterialDeltas;
 };
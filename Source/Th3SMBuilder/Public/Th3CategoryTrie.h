@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Splits a set of package paths into build menu categories and sub-categories
+ * that follow the folder structure (game / mod / folder / ...).
+ *
+ * Folders form a trie, and each level of the menu is a partition of a subtree
+ * with at most a given number of groups. The partition starts with the whole
+ * subtree as a single group and keeps splitting the largest group into its
+ * children (plus the assets directly in it) while the limit allows, so long
+ * chains of single folders collapse and big folders get split first. A folder
+ * with more children than the limit is split into ranges of its children
+ * instead, which are labelled with the first and last folder in them.
+ */
+class TH3SMBUILDER_API FTh3CategoryTrie
+{
+public:
+	struct FGroup
+	{
+		FString Label;
+		/* Category of a sub-category */
+		int32 Parent = INDEX_NONE;
+	};
+
+	void Build(TConstArrayView<FString> PackagePaths, const int32 MaxCategories, const int32 MaxSubCategories);
+
+	const TArray<FGroup>& GetCategories() const
+	{
+		return Categories;
+	}
+
+	const TArray<FGroup>& GetSubCategories() const
+	{
+		return SubCategories;
+	}
+
+	/* Category and sub-category of a package path given to Build, INDEX_NONE if unknown */
+	TPair<int32, int32> Find(const FString& PackagePath) const;
+private:
+	struct FNode
+	{
+		int32 Parent = INDEX_NONE;
+		FString Path;
+		TMap<FString, int32> Children;
+		/* Same as Children, in path order */
+		TArray<int32> SortedChildren;
+		/* Assets directly in this folder, and in the whole subtree */
+		int32 NumDirect = 0;
+		int32 NumTotal = 0;
+	};
+
+	/* A whole subtree, only the assets directly in its root, or a range of its children */
+	struct FPart
+	{
+		int32 Node;
+		bool bDirectOnly = false;
+		/* Indices into SortedChildren of Node, each child is whole */
+		int32 First = INDEX_NONE;
+		int32 Last = INDEX_NONE;
+	};
+
+	int32 FindNode(const FString& PackagePath) const;
+	int32 GetNumPieces(const FPart& Part) const;
+	int32 GetNumTotal(const FPart& Part) const;
+	const FString& GetSortPath(const FPart& Part) const;
+	/* Adds the pieces of a part, or NumGroups ranges of them */
+	void Split(const FPart& Part, const int32 NumGroups, TArray<FPart>& out_Parts) const;
+	void Partition(const FPart& Whole, const int32 MaxParts, TArray<FPart>& out_Parts) const;
+	int32 FindGroup(int32 Node, const TMap<int32, int32>& Direct, const TMap<int32, int32>& Whole) const;
+
+	TArray<FNode> Nodes;
+	TArray<FGroup> Categories;
+	TArray<FGroup> SubCategories;
+	TMap<int32, int32> DirectCategories;
+	TMap<int32, int32> WholeCategories;
+	TMap<int32, int32> DirectSubCategories;
+	TMap<int32, int32> WholeSubCategories;
+};
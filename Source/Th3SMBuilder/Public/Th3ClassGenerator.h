@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Generates many classes in one go, remembering every class it generated.
+ *
+ * Name collisions are found with a lookup in an in-memory set instead of
+ * searching the object hash, and a colliding name gets a suffix derived
+ * from a stable key (e.g. the source asset path). The first class to take
+ * a name keeps it as is, so names only stay the same across runs when
+ * they are claimed in the same order, e.g. sorted by asset path.
+ *
+ * Every class generated by the mod has to go through here, as classes
+ * made elsewhere are only noticed by the object hash check in debug builds.
+ */
+class TH3SMBUILDER_API FTh3ClassGenerator
+{
+public:
+	/* Makes room for this many more classes */
+	void Reserve(const int32 NumClasses);
+
+	/* Returns Name, or Name with a suffix derived from Key if it is already taken in the package */
+	FName MakeUniqueName(const FName Package, const FString& Name, const FString& Key) const;
+
+	/* Like MakeUniqueName, but also keeps the name from being handed out again before it is generated */
+	FName ClaimUniqueName(const FName Package, const FName Name, const FString& Key);
+
+	/* Generates a class, which must not exist yet */
+	UClass* Generate(const FName Package, const FName Name, UClass* ParentClass);
+
+	int32 Num() const
+	{
+		return Generated.Num();
+	}
+private:
+	TSet<FTopLevelAssetPath> Generated;
+	TSet<FTopLevelAssetPath> Claimed;
+
+	bool IsTaken(const FTopLevelAssetPath& Path) const
+	{
+		return Generated.Contains(Path) or Claimed.Contains(Path);
+	}
+};
@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Th3CollisionManager.generated.h"
+
+class ATh3BuildableSM;
+
+/*
+ * Gives buildables with the proximity collision policy their full mesh
+ * collision only while a player is nearby, and bounds collision otherwise.
+ *
+ * Buildables are bucketed in a uniform grid with cells as large as the
+ * upgrade radius, in every cell their bounds overlap, so every check only
+ * looks at the cells around players. Distances are measured from players to
+ * the bounds, so a player standing on or inside a large mesh is near it.
+ * Buildables are downgraded again once all players are further away than
+ * the radius plus some slack, so walking along the edge does not flip them.
+ *
+ * Players are taken from the player states of the game state on both the
+ * server and clients, so both agree on which buildables have full collision.
+ */
+UCLASS()
+class TH3SMBUILDER_API UTh3CollisionManager : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	static UTh3CollisionManager* Get(const UObject* WorldContext);
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void Register(ATh3BuildableSM* Buildable);
+	void Unregister(ATh3BuildableSM* Buildable);
+
+	/* Gives a buildable full collision until players are far away again */
+	void Upgrade(ATh3BuildableSM* Buildable);
+
+	/* Keeps a buildable upgraded regardless of distance, e.g. while the build gun looks at it */
+	void Pin(ATh3BuildableSM* Buildable);
+	void Unpin(ATh3BuildableSM* Buildable);
+
+	int32 GetNumUpgraded() const
+	{
+		return Upgraded.Num();
+	}
+private:
+	FIntVector GetCell(const FVector& Location) const;
+	FBox GetBounds(const TWeakObjectPtr<ATh3BuildableSM>& Buildable) const;
+	void UpdateUpgrades(const TArray<FVector>& PlayerLocations);
+
+	float Radius = 2000.0f;
+	float Slack = 500.0f;
+	float CheckInterval = 0.25f;
+	float TimeUntilCheck = 0.0f;
+
+	TMap<FIntVector, TArray<TWeakObjectPtr<ATh3BuildableSM>>> Cells;
+	/* Bounds every buildable was bucketed with, so it leaves the same cells */
+	TMap<TWeakObjectPtr<ATh3BuildableSM>, FBox> RegisteredBounds;
+	TSet<TWeakObjectPtr<ATh3BuildableSM>> Upgraded;
+	TSet<TWeakObjectPtr<ATh3BuildableSM>> Pinned;
+};
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * On-disk cache of asset registry queries, stored in the Saved directory.
+ *
+ * Assets are grouped by mount root ("/Game", "/SML", ...), and every root is
+ * keyed by a hash of whatever provides its content (game build or plugin).
+ * Only roots whose hash changed have to be queried again, the rest is read
+ * back from the manifest as is.
+ */
+class TH3SMBUILDER_API FTh3DiscoveryManifest
+{
+public:
+	struct FRootEntry
+	{
+		uint32 ContentHash = 0;
+		TArray<FSoftObjectPath> Assets;
+
+		friend FArchive& operator<<(FArchive& Ar, FRootEntry& Entry);
+	};
+
+	/* Reads the manifest from disk, returns false if there was none or it was unusable */
+	bool Load();
+
+	/* Writes the manifest to disk if anything was rediscovered since loading it */
+	bool SaveIfDirty();
+
+	/* Appends all assets of a class, querying the asset registry only for stale roots */
+	void Discover(UClass* BaseClass, TArray<FSoftObjectPath>& out_Paths);
+
+	SIZE_T GetAllocatedSize() const;
+
+	static FString GetManifestPath();
+	static FString GetMountRoot(const FString& PackageName);
+	static uint32 HashMountRoot(const FString& MountRoot);
+private:
+	/* Class path -> mount root -> assets */
+	TMap<FString, TMap<FString, FRootEntry>> Classes;
+	bool bDirty = false;
+};
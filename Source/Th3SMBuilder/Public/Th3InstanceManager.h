@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Th3InstanceManager.generated.h"
+
+class UHierarchicalInstancedStaticMeshComponent;
+
+/*
+ * Draws placed buildables that share a mesh and materials as instances of a
+ * single component, instead of one primitive and one draw call per copy.
+ *
+ * Buildables unregister their own mesh component while they are drawn as an
+ * instance, and collide through their bounding box. It is only registered
+ * again, but hidden, while they need the collision of the mesh.
+ */
+UCLASS()
+class TH3SMBUILDER_API UTh3InstanceManager : public UWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	static UTh3InstanceManager* Get(const UObject* WorldContext);
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	/* Draws the buildable as an instance, replacing any instance it already had */
+	bool AddInstance(AActor* Buildable, UStaticMesh* Mesh, const TArray<UMaterialInterface*>& Materials, const FTransform& Transform);
+
+	/* Stops drawing the buildable as an instance, returns false if it was not */
+	bool RemoveInstance(AActor* Buildable);
+
+	/* Component and instance index drawing the buildable, false if it is not drawn as an instance */
+	bool FindInstance(AActor* Buildable, UHierarchicalInstancedStaticMeshComponent*& out_Component, int32& out_Instance) const;
+
+	int32 GetNumGroups() const
+	{
+		return GroupIds.Num();
+	}
+
+	int32 GetNumInstances() const
+	{
+		return Handles.Num();
+	}
+private:
+	struct FGroupKey
+	{
+		UStaticMesh* Mesh;
+		TArray<UMaterialInterface*> Materials;
+
+		bool operator==(const FGroupKey& Other) const
+		{
+			return Mesh == Other.Mesh and Materials == Other.Materials;
+		}
+
+		friend uint32 GetTypeHash(const FGroupKey& Key)
+		{
+			uint32 Hash = GetTypeHash(Key.Mesh);
+			for (const UMaterialInterface* Material : Key.Materials) {
+				Hash = HashCombine(Hash, GetTypeHash(Material));
+			}
+			return Hash;
+		}
+	};
+
+	struct FGroup
+	{
+		FGroupKey Key;
+		UHierarchicalInstancedStaticMeshComponent* Component = nullptr;
+		/* Buildable drawn by each instance, in the same order as the component */
+		TArray<TObjectKey<AActor>> Owners;
+	};
+
+	struct FHandle
+	{
+		int32 Group;
+		int32 Instance;
+	};
+
+	UHierarchicalInstancedStaticMeshComponent* MakeComponent(const FGroupKey& Key);
+
+	/* Owns all instance components */
+	UPROPERTY()
+	AActor* Host;
+
+	TSparseArray<FGroup> Groups;
+	TMap<FGroupKey, int32> GroupIds;
+	TMap<TObjectKey<AActor>, FHandle> Handles;
+};
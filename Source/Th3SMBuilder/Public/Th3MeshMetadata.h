@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Th3MeshMetadata.generated.h"
+
+class UStaticMesh;
+
+/* Everything the metadata table knows about one mesh */
+USTRUCT(BlueprintType)
+struct TH3SMBUILDER_API FTh3MeshInfo
+{
+	GENERATED_BODY()
+public:
+	/* False if the mesh id is unknown, or the asset registry had no tags for it */
+	UPROPERTY(BlueprintReadOnly)
+	bool bValid = false;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Triangles = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Vertices = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumLODs = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumMaterials = 0;
+
+	/* Size of the bounding box */
+	UPROPERTY(BlueprintReadOnly)
+	FVector ApproxSize = FVector::ZeroVector;
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bNanite = false;
+};
+
+/*
+ * Per mesh statistics read from asset registry tags, so nothing has to be loaded.
+ *
+ * Kept as one array per field, indexed by mesh id (the index of the mesh in
+ * the sorted list buildables get generated from), so that scanning a single
+ * field for sorting or filtering only touches that field.
+ */
+class TH3SMBUILDER_API FTh3MeshMetadata
+{
+public:
+	void Build(TConstArrayView<TSoftObjectPtr<UStaticMesh>> Meshes);
+
+	FTh3MeshInfo Get(const int32 MeshId) const;
+
+	int32 Num() const
+	{
+		return Triangles.Num();
+	}
+
+	TConstArrayView<int32> GetTriangles() const
+	{
+		return Triangles;
+	}
+
+	TConstArrayView<int32> GetVertices() const
+	{
+		return Vertices;
+	}
+
+	SIZE_T GetAllocatedSize() const;
+private:
+	TArray<int32> Triangles;
+	TArray<int32> Vertices;
+	TArray<uint8> NumLODs;
+	TArray<uint8> NumMaterials;
+	TArray<FVector3f> ApproxSizes;
+	TBitArray<> Nanite;
+	TBitArray<> Valid;
+};
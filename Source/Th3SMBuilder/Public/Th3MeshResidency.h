@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Th3MeshResidency.generated.h"
+
+class UStaticMesh;
+
+/*
+ * Decides which generated meshes stay loaded, instead of holding on to all of them.
+ *
+ * Meshes are reference counted: placed buildables and holograms acquire their
+ * mesh and release it when they go away. Meshes nobody holds stay loaded as
+ * recently used until the resident meshes go over the budget, and then the
+ * least recently used ones are let go and can be garbage collected.
+ */
+UCLASS()
+class TH3SMBUILDER_API UTh3MeshResidency : public UObject
+{
+	GENERATED_BODY()
+public:
+	/* Only exists when the root instance has mesh residency enabled */
+	static UTh3MeshResidency* Get(UObject* WorldContext);
+
+	/* Loads the mesh if needed and keeps it loaded until released */
+	UStaticMesh* Acquire(const TSoftObjectPtr<UStaticMesh>& MeshPtr);
+
+	void Release(const TSoftObjectPtr<UStaticMesh>& MeshPtr);
+
+	/* Loads the mesh if needed and marks it as recently used, without holding it. Never evicts the returned mesh itself */
+	UStaticMesh* Touch(const TSoftObjectPtr<UStaticMesh>& MeshPtr);
+
+	/* Called for every mesh that is let go, so that raw references to it can be cleared */
+	TMulticastDelegate<void(const FSoftObjectPath&)> OnMeshEvicted;
+
+	/* Meshes nobody holds get evicted while more than this many bytes are resident */
+	int64 BudgetBytes = 0;
+
+	int64 GetResidentBytes() const
+	{
+		return ResidentBytes;
+	}
+private:
+	struct FEntry
+	{
+		FSoftObjectPath Path;
+		int32 RefCount = 0;
+		int64 Size = 0;
+		/* Neighbours in the list of unused meshes, least recently used first */
+		int32 Prev = INDEX_NONE;
+		int32 Next = INDEX_NONE;
+	};
+
+	int32 FindOrLoad(const TSoftObjectPtr<UStaticMesh>& MeshPtr);
+	void Link(const int32 Slot);
+	void Unlink(const int32 Slot);
+	void Evict(const int32 Slot);
+	void Trim();
+
+	/* Slots are shared with Meshes, which holds the references the garbage collector sees */
+	TArray<FEntry> Entries;
+
+	UPROPERTY()
+	TArray<UStaticMesh*> Meshes;
+
+	TMap<FSoftObjectPath, int32> Slots;
+	TArray<int32> FreeSlots;
+	int32 Head = INDEX_NONE;
+	int32 Tail = INDEX_NONE;
+	int64 ResidentBytes = 0;
+};
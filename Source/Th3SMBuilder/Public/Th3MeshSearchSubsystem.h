@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Th3TokenTrie.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Resources/FGBuildingDescriptor.h"
+#include "Th3MeshSearchSubsystem.generated.h"
+
+/*
+ * Finds generated buildables by mesh path, without going through the build menu.
+ *
+ * Every descriptor is indexed by the path segments and words of its mesh and
+ * of its mesh aliases, and every word of a query has to be the start of one
+ * of those. Results come in mesh path order, one page at a time, and can be
+ * handed to UTh3SMBuilderBPFL::RequestMeshRecipe before building them.
+ */
+UCLASS()
+class TH3SMBUILDER_API UTh3MeshSearchSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+public:
+	static UTh3MeshSearchSubsystem* Get(UObject* WorldContext);
+
+	/* False until buildable generation is done */
+	UFUNCTION(BlueprintPure)
+	bool IsReady() const;
+
+	/* Fills one page of matching descriptors and returns the number of matches over all pages */
+	UFUNCTION(BlueprintCallable, BlueprintPure = false)
+	int32 SearchMeshes(TArray<TSubclassOf<UFGBuildingDescriptor>>& out_Descriptors, const FString& Query, int32 PageIndex = 0, int32 PageSize = 50);
+
+	virtual void Deinitialize() override;
+protected:
+	/* Builds the index the first time it is needed after generation, false if it is too early */
+	bool BuildIndex();
+
+	/* Document ids of the trie index into this */
+	UPROPERTY()
+	TArray<TSubclassOf<UFGBuildingDescriptor>> Descriptors;
+
+	FTh3TokenTrie Trie;
+	bool bIndexBuilt = false;
+};
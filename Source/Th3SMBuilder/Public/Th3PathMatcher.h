@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Decides which packages to discover from include and exclude rules.
+ *
+ * Rules are package path prefixes that match whole folders, like "/Game/Dev".
+ * A "*" matches any part of a single folder name, so "/*/Developers" matches
+ * a Developers folder in any root and "/ControlRig*" matches every root whose
+ * name starts with ControlRig. They get compiled into a trie of FName folders,
+ * so checking a package only looks up existing names, compares the folders
+ * against the few rules with a "*" and never allocates. The most specific
+ * (deepest) matching rule wins, exclude rules win ties, and without include
+ * rules everything else passes.
+ */
+class TH3SMBUILDER_API FTh3PathMatcher
+{
+public:
+	void Compile(TConstArrayView<FString> IncludeRules, TConstArrayView<FString> ExcludeRules);
+
+	bool IsIncluded(const FName PackageName) const;
+private:
+	enum class ERule : uint8
+	{
+		None,
+		Include,
+		Exclude,
+	};
+
+	struct FNode
+	{
+		TMap<FName, int32> Children;
+		/* Children for folders with a "*", compared one by one */
+		TArray<TPair<FString, int32>> Patterns;
+		ERule Rule = ERule::None;
+	};
+
+	struct FSegment
+	{
+		/* NAME_None if nobody ever used the folder as a name */
+		FName Name;
+		FStringView Text;
+	};
+
+	void AddRule(const FString& Rule, const ERule Kind);
+	void Match(const int32 Node, TConstArrayView<FSegment> Segments, const int32 Depth, int32& out_Depth, ERule& out_Rule) const;
+	static bool MatchesPattern(const FStringView Pattern, const FStringView Text);
+
+	TArray<FNode> Nodes;
+	bool bHasIncludes = false;
+};
@@ -4,16 +4,30 @@
 
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "Resources/FGBuildingDescriptor.h"
+#include "Th3MeshMetadata.h"
 #include "Th3SMBuilderBPFL.generated.h"
 
 UCLASS()
 class TH3SMBUILDER_API UTh3SMBuilderBPFL : public UBlueprintFunctionLibrary
 {
 	GENERATED_BODY()
-
+public:
 	UFUNCTION(BlueprintCallable, Category = "Th3SMBuilderBPFL")
 	static void SplitIntoWords(TArray<FString>& out_SearchWords, const FString& SearchQuery);
 
 	UFUNCTION(BlueprintCallable, Category = "Th3SMBuilderBPFL")
 	static bool ContainsAllWords(const FString& Str, const TArray<FString>& SearchWords);
+
+	/* Batch version of ContainsAllWords, returns the indices of all matching candidates */
+	UFUNCTION(BlueprintCallable, Category = "Th3SMBuilderBPFL")
+	static void FindAllContainingWords(TArray<int32>& out_Indices, const TArray<FString>& Candidates, const TArray<FString>& SearchWords);
+
+	/* Makes the recipe for a generated descriptor available, call it when the player picks a mesh */
+	UFUNCTION(BlueprintCallable, Category = "Th3SMBuilderBPFL", Meta = (WorldContext = "WorldContext"))
+	static void RequestMeshRecipe(UObject* WorldContext, TSubclassOf<UFGBuildingDescriptor> Descriptor);
+
+	/* Mesh statistics for a generated descriptor, without loading the mesh */
+	UFUNCTION(BlueprintPure, Category = "Th3SMBuilderBPFL", Meta = (WorldContext = "WorldContext"))
+	static FTh3MeshInfo GetMeshInfoFor(UObject* WorldContext, TSubclassOf<UFGBuildingDescriptor> Descriptor);
 };
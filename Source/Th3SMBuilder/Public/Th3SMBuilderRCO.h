@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FGRemoteCallObject.h"
+#include "FGRecipe.h"
+#include "Th3SMBuilderRCO.generated.h"
+
+class ATh3BuildableSM;
+
+/* Lets clients ask the server to make a lazily unlocked recipe available, or to change a material */
+UCLASS()
+class TH3SMBUILDER_API UTh3SMBuilderRCO : public UFGRemoteCallObject
+{
+	GENERATED_BODY()
+public:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/* Makes a generated recipe available, through the server if this is a client */
+	static void UnlockRecipe(UObject* WorldContext, TSubclassOf<UFGRecipe> Recipe);
+
+	UFUNCTION(Server, Reliable)
+	void Server_UnlockRecipe(TSubclassOf<UFGRecipe> Recipe);
+
+	/* Sends a material a client assigned to a placed buildable to the server */
+	static void SetBuildableMaterial(ATh3BuildableSM* Buildable, const int32 Index, UMaterialInterface* Material);
+
+	/* By path, as the server may not have the material loaded */
+	UFUNCTION(Server, Reliable)
+	void Server_SetBuildableMaterial(ATh3BuildableSM* Buildable, int32 Index, const FSoftObjectPath& Material);
+
+protected:
+	/* Only on the server, and only for recipes that were generated lazily */
+	static void GrantRecipe(UWorld* World, TSubclassOf<UFGRecipe> Recipe);
+
+	/* Remote call objects do not get created without a replicated property */
+	UPROPERTY(Replicated)
+	bool bDummy = true;
+};
@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "Module/GameInstanceModule.h"
 #include "Module/GameWorldModule.h"
+#include "Containers/Ticker.h"
 
 #include "Th3SMBuilderRootGame.generated.h"
 
@@ -15,4 +16,10 @@ public:
 	UTh3SMBuilderRootGame();
 	~UTh3SMBuilderRootGame();
 	virtual void DispatchLifecycleEvent(ELifecyclePhase Phase) override;
+	virtual void BeginDestroy() override;
+protected:
+	FTSTicker::FDelegateHandle UnlockTicker;
+
+	/* Returns false once the schematics have been handed out */
+	bool TryGiveAccessToSchematics(float DeltaTime);
 };
@@ -6,21 +6,64 @@
 #include "Th3Utilities.h"
 #include "Th3SMBuilder.h"
 #include "Th3BuildableSM.h"
+#include "Th3DiscoveryManifest.h"
+#include "Th3ClassGenerator.h"
+#include "Th3CategoryTrie.h"
+#include "Th3PathMatcher.h"
+#include "Th3MeshResidency.h"
+#include "Th3MeshMetadata.h"
+#include "MaterialEntry.h"
 
 #include "Module/GameInstanceModule.h"
 #include "Resources/FGItemDescriptor.h"
 #include "Resources/FGBuildingDescriptor.h"
 #include "FGBuildCategory.h"
+#include "FGBuildSubCategory.h"
 #include "FGRecipe.h"
 #include "FGSchematic.h"
 #include "Unlocks/FGUnlock.h"
 #include "Unlocks/FGUnlockRecipe.h"
 #include "Engine/AssetManager.h"
 #include "Engine/StreamableManager.h"
+#include "Containers/Ticker.h"
 #include "AssetRegistry/AssetRegistryModule.h"
 
 #include "Th3SMBuilderRootInstance.generated.h"
 
+UENUM(BlueprintType)
+enum class ETh3CategoryMode : uint8
+{
+	/* Fixed number of buildables per category, in mesh path order */
+	ByCount,
+	/* Categories and sub-categories follow the folders meshes are in */
+	ByPath,
+};
+
+/*
+ * Everything needed to generate the classes for one mesh, worked out up front.
+ * Plans only depend on the sorted list of mesh paths, so class names and path
+ * categories are the same across runs and between server and client. Menu
+ * order is handed out as meshes get their buildable.
+ */
+struct FTh3BuildablePlan
+{
+	TSoftObjectPtr<UStaticMesh> MeshPtr;
+	FString MeshPath;
+	FName BuildablePackage;
+	FName BuildableName;
+	FName DescPackage;
+	FName DescName;
+	FName RecipePackage;
+	FName RecipeName;
+	/* Index into SMPtrs and into the mesh metadata table */
+	int32 MeshId = INDEX_NONE;
+	/* Only set once the mesh gets a buildable, as meshes that fail to load or are aliases get none */
+	int32 Priority = 0;
+	/* Index into PathCategories, or into BuildCategories when categories go by count */
+	int32 Category = INDEX_NONE;
+	int32 SubCategory = INDEX_NONE;
+};
+
 UCLASS(Abstract)
 class TH3SMBUILDER_API UTh3SMBuilderRootInstance : public UGameInstanceModule
 {
@@ -34,6 +77,7 @@ public:
 	UPROPERTY()
 	UFGUnlockRecipe* ModifiedUnlock;
 
+	/* Stays empty with mesh residency, meshes are then only held through GetMeshResidency() */
 	UPROPERTY(BlueprintReadWrite)
 	TArray<UStaticMesh*> StaticMeshes;
 
@@ -48,6 +92,37 @@ public:
 
 	UPROPERTY(BlueprintReadWrite)
 	TArray<TSoftObjectPtr<UMaterialInterface>> MatPtrs;
+
+	/* Filled instead of Materials when streaming materials */
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FTh3MaterialInfo> MaterialInfos;
+
+	UPROPERTY(BlueprintReadOnly)
+	TMap<TSubclassOf<UFGBuildingDescriptor>, TSubclassOf<UFGRecipe>> RecipesByDescriptor;
+
+	/* Read from asset registry tags, the mesh does not have to be loaded */
+	UFUNCTION(BlueprintPure)
+	FTh3MeshInfo GetMeshInfo(int32 MeshId) const
+	{
+		return MeshMetadata.Get(MeshId);
+	}
+
+	const FTh3MeshMetadata& GetMeshMetadata() const
+	{
+		return MeshMetadata;
+	}
+
+	UFUNCTION(BlueprintPure)
+	TSubclassOf<UFGRecipe> GetRecipeFor(TSubclassOf<UFGBuildingDescriptor> Descriptor) const
+	{
+		return RecipesByDescriptor.FindRef(Descriptor);
+	}
+
+	/* True for generated recipes that are only unlocked once asked for */
+	bool IsLazyRecipe(TSubclassOf<UFGRecipe> Recipe) const
+	{
+		return bLazyRecipeUnlock and LazyRecipes.Contains(Recipe);
+	}
 public:
 	std::atomic_bool bMaterialsReady;
 	std::atomic_bool bBuildablesReady;
@@ -59,40 +134,122 @@ public:
 	~UTh3SMBuilderRootInstance();
 	virtual void DispatchLifecycleEvent(ELifecyclePhase Phase) override;
 
+	virtual void BeginDestroy() override;
+
 	static UTh3SMBuilderRootInstance* Get(UWorld* World);
+	static UTh3SMBuilderRootInstance* Get(const UGameInstance* GameInstance);
 	static UTh3SMBuilderRootInstance* Get(UObject* WorldContext);
+
+	/* True on dedicated servers, which have no use for anything cosmetic */
+	bool IsHeadlessServer() const
+	{
+		return bHeadlessServerProfile and IsRunningDedicatedServer();
+	}
+
+	/* Null unless bUseMeshResidency is set */
+	UTh3MeshResidency* GetMeshResidency() const
+	{
+		return MeshResidency;
+	}
+
+	/* Fraction of static meshes that have gone through buildable generation */
+	UFUNCTION(BlueprintPure)
+	float GetBuildablesProgress() const;
 protected:
-	int32 Priority = 0;
+	FTh3MeshMetadata MeshMetadata;
+
+	/* One per entry in SMPtrs, sorted by mesh path */
+	TArray<FTh3BuildablePlan> Plans;
+
+	/* Next entry in Plans to generate classes for */
+	int32 NextMeshIndex = 0;
+
+	FTSTicker::FDelegateHandle GenerationTicker;
+
+	/* Keeps the meshes loaded until every one of them has been generated */
+	TSharedPtr<FStreamableHandle> MeshLoadHandle;
 	
 	UPROPERTY()
 	TArray<TSubclassOf<UFGBuildCategory>> BuildCategories;
 
-	TSubclassOf<UFGBuildCategory> MakeCategory();
-	void MakeBuildable(UStaticMesh* Mesh);
-	void MakeBuildingDescriptor(TSubclassOf<ATh3BuildableSM> Buildable);
-	void MakeBuildingRecipe(TSubclassOf<UFGBuildingDescriptor> BuildDesc);
+	TSubclassOf<UFGBuildCategory> MakeCategory(const int32 Idx);
+
+	FTh3CategoryTrie CategoryTrie;
+
+	UPROPERTY()
+	TArray<TSubclassOf<UFGBuildCategory>> PathCategories;
+
+	UPROPERTY()
+	TArray<TSubclassOf<UFGCategory>> PathSubCategories;
+
+	/* Generates the categories and sub-categories grouped by CategoryTrie */
+	void MakePathCategories();
+	/* Sorts SMPtrs, fills Plans and builds CategoryTrie, does not touch any UObject */
+	void MakePlans();
+	void MakeBuildable(const FTh3BuildablePlan& Plan);
+	void MakeBuildingDescriptor(TSubclassOf<ATh3BuildableSM> Buildable, const FTh3BuildablePlan& Plan);
+	void MakeBuildingRecipe(TSubclassOf<UFGBuildingDescriptor> BuildDesc, const FTh3BuildablePlan& Plan);
+
+	void ProcessOneSM(FTh3BuildablePlan& Plan);
+
+	UPROPERTY()
+	UTh3MeshResidency* MeshResidency;
+
+	/* Buildables by mesh, to clear the mesh of their CDO when it gets evicted */
+	TMap<FSoftObjectPath, ATh3BuildableSM*> BuildablesByMesh;
+
+	void OnMeshEvicted(const FSoftObjectPath& MeshPath);
+
+	/* Buildables by the geometry hash of their mesh, when deduplicating */
+	TMap<uint64, ATh3BuildableSM*> BuildablesByGeometry;
+
+	/* Adds a duplicate mesh to an existing buildable instead of generating one */
+	void AddMeshAlias(ATh3BuildableSM* CDO, const FTh3BuildablePlan& Plan);
 
-	void ProcessOneSM(const TSoftObjectPtr<UStaticMesh>& MeshPtr);
+	/* Same for meshes that only differ in name or LODs past the first, 0 if the vertices are not readable */
+	static uint64 HashGeometry(const UStaticMesh* Mesh);
 	void ProcessStaticMeshes();
 
+	void StartGeneration();
+	bool TickGeneration(float DeltaTime);
+
 	void ProcessOneMat(const FSoftObjectPath& MatPath);
 	void ProcessMaterialInterfaces();
 
-	void ProcessAllOf(UClass* BaseClass, const TFunction<void(const TArray<FSoftObjectPath>&)> StoreList, const TFunction<void()> Callback)
+	/* Next entry in MatPtrs to load when streaming materials */
+	int32 NextMaterialIndex = 0;
+
+	/* Used physical memory the ceiling is measured from, so memory used by everything else does not count */
+	uint64 MaterialMemoryBaseline = 0;
+
+	/* Garbage collections waited for since the last batch, streaming goes on anyway after a few */
+	int32 NumMaterialMemoryWaits = 0;
+
+	FTSTicker::FDelegateHandle MaterialStreamTicker;
+
+	void StreamNextMaterialBatch();
+	void OnMaterialBatchLoaded(TArray<FSoftObjectPath> Batch);
+	bool IsOverMaterialMemoryCeiling() const;
+
+	FTh3DiscoveryManifest DiscoveryManifest;
+
+	FTh3ClassGenerator ClassGenerator;
+
+	TSet<TSubclassOf<UFGRecipe>> LazyRecipes;
+
+	FTh3PathMatcher PathMatcher;
+
+	TArray<FSoftObjectPath> DiscoverAllOf(UClass* BaseClass);
+
+	/* The assets are only kept loaded for as long as the returned handle is */
+	TSharedPtr<FStreamableHandle> ProcessAllOf(UClass* BaseClass, const TFunction<void(const TArray<FSoftObjectPath>&)> StoreList, const TFunction<void()> Callback)
 	{
 		const FString ClassName = BaseClass->GetName();
-		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Looking for '%s'..."), *ClassName);
-		FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry");
-		TArray<FAssetData> AssetData;
-		AssetRegistryModule.Get().GetAssetsByClass(FTopLevelAssetPath(BaseClass), AssetData, true);
-		TArray<FSoftObjectPath> SoftPaths;
-		const auto asset_predicate = [](const FAssetData& Asset) { return not Asset.PackageName.ToString().StartsWith(TEXT("/ControlRig")); };
-		const auto asset_transform = [](const FAssetData& Asset) { return Asset.GetSoftObjectPath(); };
-		Algo::TransformIf(AssetData, SoftPaths, asset_predicate, asset_transform);
+		TArray<FSoftObjectPath> SoftPaths = DiscoverAllOf(BaseClass);
 		Invoke(StoreList, SoftPaths);
 		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Processing %d '%s'..."), SoftPaths.Num(), *ClassName);
 		const double Begin = FPlatformTime::Seconds();
-		UAssetManager::GetStreamableManager().RequestAsyncLoad(SoftPaths, [Begin, ClassName, Callback]() {
+		return UAssetManager::GetStreamableManager().RequestAsyncLoad(SoftPaths, [Begin, ClassName, Callback]() {
 			const double Middle = FPlatformTime::Seconds();
 			UE_LOG(LogTh3SMBuilderCpp, Warning, TEXT("Took %f ms to load '%s'"), (Middle - Begin) * 1000, *ClassName);
 			Invoke(Callback);
@@ -110,14 +267,7 @@ protected:
 	void LoadAsync(UClass* BaseClass, const TFunction<void(const TArray<FSoftObjectPath>&)> Callback)
 	{
 		const FString ClassName = BaseClass->GetName();
-		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Looking for '%s'..."), *ClassName);
-		FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry");
-		TArray<FAssetData> AssetData;
-		AssetRegistryModule.Get().GetAssetsByClass(FTopLevelAssetPath(BaseClass), AssetData, true);
-		TArray<FSoftObjectPath> SoftPaths;
-		const auto asset_predicate = [](const FAssetData& Asset) { return not Asset.PackageName.ToString().StartsWith(TEXT("/ControlRig")); };
-		const auto asset_transform = [](const FAssetData& Asset) { return Asset.GetSoftObjectPath(); };
-		Algo::TransformIf(AssetData, SoftPaths, asset_predicate, asset_transform);
+		TArray<FSoftObjectPath> SoftPaths = DiscoverAllOf(BaseClass);
 		UE_LOG(LogTh3SMBuilderCpp, Display, TEXT("Loading %d '%s'..."), SoftPaths.Num(), *ClassName);
 		const double Begin = FPlatformTime::Seconds();
 		UAssetManager::GetStreamableManager().RequestAsyncLoad(SoftPaths, [Begin, ClassName, SoftPaths, Callback]() {
@@ -138,6 +288,17 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
 	int32 EntriesPerCategory = 1;
 
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	ETh3CategoryMode CategoryMode = ETh3CategoryMode::ByPath;
+
+	/* Most categories the build menu gets when making them by path */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration", Meta = (EditCondition = "CategoryMode == ETh3CategoryMode::ByPath", ClampMin = 1))
+	int32 MaxCategories = 24;
+
+	/* Most sub-categories per category when making them by path */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration", Meta = (EditCondition = "CategoryMode == ETh3CategoryMode::ByPath", ClampMin = 1))
+	int32 MaxSubCategories = 32;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
 	UTexture2D* ItemIcon;
 
@@ -158,4 +319,106 @@ public:
 
 	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
 	FCollisionProfileName CollisionProfile;
+
+	/*
+	 * Generate buildables from asset registry data alone, without loading any
+	 * static mesh. Meshes are then loaded the first time something needs them.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	bool bGenerateFromAssetData = false;
+
+	/*
+	 * Give meshes with the same geometry and materials a single buildable, listing the
+	 * others as aliases. Needs the meshes loaded, so it does nothing with bGenerateFromAssetData,
+	 * and skips meshes without CPU access as their vertices cannot be compared.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	bool bDeduplicateMeshes = false;
+
+	/*
+	 * Only keep meshes loaded while they are placed, previewed in a hologram or
+	 * recently used, instead of keeping every mesh loaded for the whole session.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	bool bUseMeshResidency = false;
+
+	/* Size in MiB above which recently used meshes get unloaded, zero for no limit */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration", Meta = (EditCondition = "bUseMeshResidency"))
+	int32 MeshResidencyBudgetMB = 512;
+
+	/*
+	 * Time in milliseconds that buildable generation may take every frame.
+	 * Zero or less generates everything at once, which hitches the game.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	float GenerationBudgetMs = 4.0f;
+
+	/* Cache asset discovery results in the Saved directory for faster startup */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	bool bUseDiscoveryManifest = true;
+
+	/*
+	 * Folders to discover meshes and materials in, like "/Game/FactoryGame", everything if empty.
+	 * A "*" matches any part of a single folder name, like "/*/Developers", see FTh3PathMatcher.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	TArray<FString> IncludePaths;
+
+	/* Folders to skip, the most specific rule wins over IncludePaths. Covers /ControlRigModules and the like by default */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	TArray<FString> ExcludePaths = { TEXT("/ControlRig*") };
+
+	/* Skip material discovery, material entries and thumbnails on dedicated servers, which then load materials once clients assign them */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	bool bHeadlessServerProfile = true;
+
+	/*
+	 * Load materials in batches and keep only what the picker needs, instead
+	 * of loading all of them at once and holding on to them forever.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	bool bStreamMaterials = false;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration", Meta = (EditCondition = "bStreamMaterials", ClampMin = 1))
+	int32 MaterialBatchSize = 256;
+
+	/* Memory in MiB that streaming may use on top of what was in use when it started before waiting for garbage collection, zero for no limit */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration", Meta = (EditCondition = "bStreamMaterials"))
+	int32 MaterialMemoryCeilingMB = 0;
+
+	/* Draw placed copies of the same mesh with the same materials as instances of one component */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	bool bUseInstancedRendering = false;
+
+	/*
+	 * Put generated classes in one package per mount root instead of one
+	 * per mesh. This changes class paths, so buildables in existing saves
+	 * would no longer be found.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	bool bSharedClassPackages = false;
+
+	/*
+	 * Keep generated recipes out of the schematic, so that unlocking it is
+	 * quick and the recipe manager stays small. Recipes are then made
+	 * available one at a time when picked, see RequestMeshRecipe.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	bool bLazyRecipeUnlock = false;
+
+	/* Unlocked instead of the generated recipes, for a way to browse and pick meshes */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration", Meta = (EditCondition = "bLazyRecipeUnlock"))
+	TSubclassOf<UFGRecipe> BrowserRecipe;
+
+	/* How placed buildables collide, proximity keeps the physics scene small in large saves */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	ETh3CollisionPolicy CollisionPolicy = ETh3CollisionPolicy::Proximity;
+
+	/* Distance from players within which buildables get their mesh collision */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration", Meta = (EditCondition = "CollisionPolicy == ETh3CollisionPolicy::Proximity"))
+	float ProximityCollisionRadius = 2000.0f;
+
+	/* Extra distance before they lose it again, so it does not flip at the edge */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration", Meta = (EditCondition = "CollisionPolicy == ETh3CollisionPolicy::Proximity"))
+	float ProximityCollisionSlack = 500.0f;
 };
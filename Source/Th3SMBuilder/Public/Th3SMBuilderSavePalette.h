@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FGSaveInterface.h"
+#include "Subsystem/ModSubsystem.h"
+#include "Th3SMBuilderSavePalette.generated.h"
+
+/*
+ * Saved once per world, holds the materials and strings that placed
+ * buildables refer to by index in the save, so that each of them is
+ * only stored once no matter how many buildables use it.
+ *
+ * The palette is rebuilt from scratch in its own PreSaveGame, which has
+ * every buildable write to it, and buildables read it back from PostLoadGame.
+ */
+UCLASS()
+class TH3SMBUILDER_API ATh3SMBuilderSavePalette : public AModSubsystem, public IFGSaveInterface
+{
+	GENERATED_BODY()
+public:
+	ATh3SMBuilderSavePalette();
+
+	static ATh3SMBuilderSavePalette* Get(UObject* WorldContext);
+
+	/* Returns the index of the material, adding it if needed */
+	int32 AddMaterial(UMaterialInterface* Material);
+
+	/* Returns the index of the string, adding it if needed */
+	int32 AddString(const FString& String);
+
+	UMaterialInterface* GetMaterial(const int32 Index) const;
+	FString GetString(const int32 Index) const;
+
+	/*
+	 * Begin IFGSaveInterface
+	 */
+	virtual bool ShouldSave_Implementation() const override
+	{
+		return true;
+	}
+	virtual void PreSaveGame_Implementation(int32 saveVersion, int32 gameVersion) override;
+	virtual void PostSaveGame_Implementation(int32 saveVersion, int32 gameVersion) override;
+	/*
+	 * End IFGSaveInterface
+	 */
+
+protected:
+	UPROPERTY(SaveGame)
+	TArray<UMaterialInterface*> Materials;
+
+	UPROPERTY(SaveGame)
+	TArray<FString> Strings;
+
+	TMap<UMaterialInterface*, int32> MaterialIndices;
+	TMap<FString, int32> StringIndices;
+};
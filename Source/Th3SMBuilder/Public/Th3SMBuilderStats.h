@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+/*
+ * Shown in-game with `stat Th3SMBuilder`, and in Unreal Insights when
+ * tracing with `-trace=cpu,Th3SMBuilder` (works on dedicated servers too).
+ */
+DECLARE_STATS_GROUP(TEXT("Th3SMBuilder"), STATGROUP_Th3SMBuilder, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Discovery"), STAT_Th3_Discovery, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Generate Class"), STAT_Th3_GenerateClass, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Make Buildable"), STAT_Th3_MakeBuildable, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Make Descriptor"), STAT_Th3_MakeDescriptor, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Make Recipe"), STAT_Th3_MakeRecipe, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Schematic Unlock"), STAT_Th3_SchematicUnlock, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Render Thumbnail"), STAT_Th3_RenderThumbnail, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Search Index"), STAT_Th3_BuildSearchIndex, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Search"), STAT_Th3_Search, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Mesh Search Index"), STAT_Th3_BuildMeshSearchIndex, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh Search"), STAT_Th3_MeshSearch, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Buildables"), STAT_Th3_NumBuildables, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mesh Aliases"), STAT_Th3_NumMeshAliases, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Thumbnails Rendered"), STAT_Th3_NumThumbnailsRendered, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Thumbnails From Cache"), STAT_Th3_NumThumbnailsCached, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Discovery Manifest"), STAT_Th3_DiscoveryManifestMemory, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Mesh Metadata"), STAT_Th3_MeshMetadataMemory, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Resident Meshes"), STAT_Th3_ResidentMeshMemory, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Search Index"), STAT_Th3_SearchIndexMemory, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Mesh Search Index"), STAT_Th3_MeshSearchIndexMemory, STATGROUP_Th3SMBuilder, TH3SMBUILDER_API);
+
+UE_TRACE_CHANNEL_EXTERN(Th3SMBuilderChannel, TH3SMBUILDER_API);
+
+/* Times the rest of the scope both as a stat and as an Insights event */
+#define TH3_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR(#Stat, Th3SMBuilderChannel)
@@ -6,6 +6,8 @@
 #include "Th3SMBuilderRootInstance.h"
 #include "SMBuilderPhotoBooth.h"
 #include "MaterialEntry.h"
+#include "Th3SearchIndex.h"
+#include "Th3ThumbnailCache.h"
 #include "CoreMinimal.h"
 #include "Subsystem/ModSubsystem.h"
 #include "Th3SMBuilderSubsystem.generated.h"
@@ -15,6 +17,8 @@ class TH3SMBUILDER_API ATh3SMBuilderSubsystem : public AModSubsystem
 {
 	GENERATED_BODY()
 public:
+	ATh3SMBuilderSubsystem();
+
 	static ATh3SMBuilderSubsystem* Get(UObject* WorldContext);
 
 	UFUNCTION(BlueprintCallable)
@@ -26,25 +30,113 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure = false)
 	void GetFilteredEntries(TArray<UMaterialEntry*>& out_FilteredEntries, const FString& SearchQuery) const;
 
+	/*
+	 * Queues rendering the thumbnail of an entry, call it when the entry gets shown.
+	 * Higher priorities are rendered first, and so are newer requests of equal priority.
+	 * Requesting a queued entry again only does something with a higher priority.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void RequestThumbnail(UMaterialEntry* Entry, int32 Priority = 0);
+
+	/*
+	 * Returns the best MaxResults entries for a query, best first.
+	 * Supports `-word`, `path:`, `domain:` and `mod:`, see FTh3SearchQuery.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure = false)
+	void SearchEntries(TArray<UMaterialEntry*>& out_Entries, const FString& SearchQuery, int32 MaxResults = 100) const;
+
 protected:
 	UFUNCTION(BlueprintImplementableEvent)
 	TArray<UMaterialInterface*> GetMaterialsEditor();
 	TArray<UMaterialInterface*> GetMaterialsGame();
 	TArray<UMaterialInterface*> GetMaterials();
+	TArray<FTh3MaterialInfo> GetMaterialInfos();
+	bool IsStreamingMaterials();
 
-	UMaterialEntry* MakeMaterialEntry(UMaterialInterface* Material, ASMBuilderPhotoBooth* PhotoBooth) const;
+	/* Material is nullptr for streamed materials, which are not loaded yet */
+	UMaterialEntry* MakeMaterialEntry(const FTh3MaterialInfo& Info, UMaterialInterface* Material) const;
+	void MakeMaterialEntries();
+	void RenderThumbnail(UMaterialEntry* MaterialEntry);
+	/* False if the thumbnail is still being read from the cache, OnThumbnailReady fires once it is */
+	bool RenderSurfaceThumbnail(UMaterialEntry* MaterialEntry, UMaterialInterface* Material);
+	void RenderBoothThumbnail(UMaterialEntry* MaterialEntry, UMaterialInterface* Material, const FString& MaterialPath, const uint32 ContentHash);
+	ASMBuilderPhotoBooth* GetPhotoBooth();
+	void BuildSearchIndex();
 
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
 
 	std::atomic_bool bEntriesReady;
 
+	/* Retries making entries until the root instance is done discovering materials */
+	FTimerHandle MaterialsReadyTimer;
+
+	/* Only has loaded materials, so it stays empty when streaming, see StreamedEntries */
 	UPROPERTY(BlueprintReadWrite)
 	TMap<UMaterialInterface*, UMaterialEntry*> MaterialEntries;
 
+	/* Keyed by path, so looking a streamed entry up does not need its material loaded */
+	UPROPERTY()
+	TMap<FSoftObjectPath, UMaterialEntry*> StreamedEntries;
+
+	/* Entries in the order they were added to the search index */
+	UPROPERTY()
+	TArray<UMaterialEntry*> IndexedEntries;
+
+	FTh3SearchIndex SearchIndex;
+
+	/* Previous search, queries that narrow it down only filter its results */
+	mutable FTh3IncrementalSearch LastSearch;
+
+	struct FThumbnailRequest
+	{
+		int32 Priority;
+		uint32 Sequence;
+		TWeakObjectPtr<UMaterialEntry> Entry;
+
+		/* Heap order, puts the most important request on top */
+		bool operator<(const FThumbnailRequest& Other) const
+		{
+			return Priority > Other.Priority or (Priority == Other.Priority and Sequence > Other.Sequence);
+		}
+	};
+	TArray<FThumbnailRequest> ThumbnailQueue;
+	uint32 ThumbnailSequence = 0;
+
+	/* Entries are ready once the queue runs empty, see bRenderThumbnailsOnDemand */
+	bool bRenderingAllThumbnails = false;
+
+	/* Spawned when the first thumbnail has to be rendered */
+	UPROPERTY()
+	ASMBuilderPhotoBooth* PhotoBooth;
+
+	FTh3ThumbnailCache ThumbnailCache;
+
 public:
 	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
 	const TSubclassOf<ASMBuilderPhotoBooth> PhotoBoothClass;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
 	int32 BrushSize = 64;
+
+	/* Shown for surface materials until their thumbnail has been rendered */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	FSlateBrush PlaceholderBrush;
+
+	/*
+	 * Only render thumbnails once the picker calls RequestThumbnail. Otherwise every
+	 * thumbnail is rendered before the entries are ready, which is what pickers that
+	 * do not call RequestThumbnail need. Streamed materials are always on demand.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	bool bRenderThumbnailsOnDemand = false;
+
+	/* Time in milliseconds that thumbnail rendering may take every frame */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	float ThumbnailBudgetMs = 2.0f;
+
+	/* Keep rendered thumbnails in the Saved directory across sessions */
+	UPROPERTY(EditDefaultsOnly, Category = "Mod Configuration")
+	bool bCacheThumbnails = true;
 };
@@ -0,0 +1,115 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Search query, parsed from whitespace separated terms:
+ *  - `word`         path contains the word, or fuzzily matches it if no path contains them all
+ *  - `-word`        path does not contain the word
+ *  - `path:word`    path contains the word, never fuzzy
+ *  - `domain:word`  tag of the entry (e.g. material domain) contains the word
+ *  - `mod:word`     mount root of the path (e.g. game or mod name) contains the word
+ * Filters of the same kind match if any of them does, different kinds must all match.
+ */
+struct TH3SMBUILDER_API FTh3SearchQuery
+{
+	TArray<FString> Words;
+	TArray<FString> Excluded;
+	TArray<FString> PathFilters;
+	TArray<FString> DomainFilters;
+	TArray<FString> ModFilters;
+
+	static FTh3SearchQuery Parse(const FString& Query);
+
+	bool IsEmpty() const
+	{
+		return Words.IsEmpty() and Excluded.IsEmpty() and PathFilters.IsEmpty() and DomainFilters.IsEmpty() and ModFilters.IsEmpty();
+	}
+};
+
+/*
+ * Case-insensitive substring search over a fixed set of strings.
+ *
+ * Every string is split into overlapping trigrams, and each trigram maps to
+ * the sorted list of strings it appears in. A query only has to intersect the
+ * lists for the trigrams of its words, and then verify the few candidates left.
+ */
+class TH3SMBUILDER_API FTh3SearchIndex
+{
+public:
+	void Reset();
+
+	/* Adds a path to the index, ids are handed out in insertion order */
+	int32 Add(const FString& Text, const FString& Tag = FString());
+
+	int32 Num() const
+	{
+		return Texts.Num();
+	}
+
+	/* Lowercase copy of the string with the given id */
+	const FString& GetText(const int32 Id) const
+	{
+		return Texts[Id];
+	}
+
+	/* Finds the ids of all strings containing every word, sorted */
+	void Query(const TArray<FString>& Words, TArray<int32>& out_Ids) const;
+
+	/* Keeps the candidate ids whose strings contain every lowercase word */
+	void Filter(TConstArrayView<int32> Candidates, const TArray<FString>& LowerWords, TArray<int32>& out_Ids) const;
+
+	/* Finds the best matches for a query, best first, with at most MaxResults ids */
+	void Search(const FTh3SearchQuery& SearchQuery, const int32 MaxResults, TArray<int32>& out_Ids) const;
+
+	static void ToLowerWords(const TArray<FString>& Words, TArray<FString>& out_LowerWords);
+
+	SIZE_T GetAllocatedSize() const;
+private:
+	struct FDocInfo
+	{
+		/* End of the mount root, e.g. 5 for "/game/..." */
+		int32 ModEnd;
+		/* Start of the last path segment */
+		int32 NameStart;
+		int32 Tag;
+	};
+
+	bool PassesFilters(const int32 Id, const FTh3SearchQuery& SearchQuery) const;
+	float ScoreExact(const int32 Id, const TArray<FString>& Words) const;
+	float ScoreFuzzy(const int32 Id, const TArray<FString>& Words) const;
+
+	using FTrigram = uint64;
+
+	static FORCEINLINE FTrigram MakeTrigram(const TCHAR* Chars)
+	{
+		return (uint64(uint16(Chars[0])) << 32) | (uint64(uint16(Chars[1])) << 16) | uint64(uint16(Chars[2]));
+	}
+
+	TArray<FString> Texts;
+	TArray<FDocInfo> Docs;
+	TArray<FString> Tags;
+	TMap<FTrigram, TArray<int32>> Postings;
+};
+
+/*
+ * Remembers the previous query on an index, so that typing more of it only
+ * filters the previous results instead of querying the whole index again.
+ */
+class TH3SMBUILDER_API FTh3IncrementalSearch
+{
+public:
+	void Reset()
+	{
+		bHasLast = false;
+	}
+
+	/* Same ids as FTh3SearchIndex::Query, valid until the next call */
+	const TArray<int32>& Search(const FTh3SearchIndex& Index, const TArray<FString>& Words);
+private:
+	TArray<FString> LastWords;
+	TArray<int32> LastIds;
+	bool bHasLast = false;
+};
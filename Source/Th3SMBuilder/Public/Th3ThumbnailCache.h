@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderCommandFence.h"
+
+class IAsyncReadFileHandle;
+class IAsyncReadRequest;
+class IFileHandle;
+class UTexture2D;
+class UTextureRenderTarget2D;
+
+/*
+ * Disk cache for rendered material thumbnails, stored in the Saved directory.
+ *
+ * Thumbnails are compressed and appended to a single pack file, and a small
+ * index maps material paths to their blob. Only the index is read up front,
+ * thumbnails are read back one at a time when they are requested. An entry is
+ * stale once the content hash of its material changes.
+ *
+ * Neither direction blocks the game thread: loads are asynchronous reads that
+ * get decompressed on the IO thread, and stores wait for the render thread to
+ * read the render target back. Both are finished by Tick on the game thread.
+ */
+class TH3SMBUILDER_API FTh3ThumbnailCache
+{
+public:
+	~FTh3ThumbnailCache();
+
+	/* Opens the cache for thumbnails of the given size and reads its index */
+	void Open(const int32 InSize);
+
+	/* Waits for pending stores, writes the index back if thumbnails were stored, and closes the cache */
+	void Close();
+
+	/* Called on the game thread with the new texture, or nullptr if the thumbnail could not be read */
+	using FOnLoaded = TFunction<void(UTexture2D*)>;
+
+	/* Starts reading a cached thumbnail into a new texture, false if it is missing or stale */
+	bool Load(const FString& MaterialPath, const uint32 ContentHash, FOnLoaded OnLoaded);
+
+	/* Stores the current contents of a render target as a thumbnail, once the render thread got to it */
+	bool Store(const FString& MaterialPath, const uint32 ContentHash, UTextureRenderTarget2D* RenderTarget);
+
+	/* Finishes the loads and stores that are done, call it every frame while there is pending work */
+	void Tick();
+
+	bool HasPendingWork() const
+	{
+		return not PendingLoads.IsEmpty() or not PendingStores.IsEmpty();
+	}
+
+	/*
+	 * Changes whenever the material asset changes on disk, or the game or mod it comes from gets updated.
+	 * 0 if there is no way to tell, such thumbnails are neither loaded from nor stored in the cache.
+	 */
+	static uint32 HashMaterial(const UMaterialInterface* Material);
+private:
+	struct FEntry
+	{
+		uint32 ContentHash = 0;
+		int64 Offset = 0;
+		int32 CompressedSize = 0;
+		int32 Width = 0;
+		int32 Height = 0;
+
+		friend FArchive& operator<<(FArchive& Ar, FEntry& Entry)
+		{
+			Ar << Entry.ContentHash;
+			Ar << Entry.Offset;
+			Ar << Entry.CompressedSize;
+			Ar << Entry.Width;
+			Ar << Entry.Height;
+			return Ar;
+		}
+	};
+
+	/* Shared with the IO thread, which fills Pixels */
+	struct FPendingLoad
+	{
+		FEntry Entry;
+		FOnLoaded OnLoaded;
+		IAsyncReadRequest* Request = nullptr;
+		TArray<FColor> Pixels;
+		std::atomic_bool bDone = false;
+		std::atomic_bool bSucceeded = false;
+	};
+
+	/* Shared with the render thread, which fills Pixels before the fence */
+	struct FPendingStore
+	{
+		FString MaterialPath;
+		FEntry Entry;
+		TArray<FColor> Pixels;
+		FRenderCommandFence Fence;
+	};
+
+	TMap<FString, FEntry> Entries;
+	TUniquePtr<IFileHandle> PackFile;
+	TUniquePtr<IAsyncReadFileHandle> ReadHandle;
+	TArray<TSharedRef<FPendingLoad, ESPMode::ThreadSafe>> PendingLoads;
+	TArray<TSharedRef<FPendingStore, ESPMode::ThreadSafe>> PendingStores;
+	int32 Size = 0;
+	bool bDirty = false;
+
+	static FString GetIndexPath();
+	static FString GetPackPath();
+	bool ReadIndex();
+	void Reset();
+	bool OpenFiles();
+	void FinishStore(FPendingStore& Store);
+	static UTexture2D* MakeTexture(const FPendingLoad& Load);
+};
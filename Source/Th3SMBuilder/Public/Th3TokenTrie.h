@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Prefix search over the tokens of a fixed set of documents.
+ *
+ * Tokens are inserted into a character trie in sorted order, so every node
+ * covers a contiguous range of the sorted tokens and finding all documents
+ * with a token starting with some prefix is one walk down the trie followed
+ * by reading the posting lists of that range.
+ */
+class TH3SMBUILDER_API FTh3TokenTrie
+{
+public:
+	void Reset();
+
+	/* Tokens may come in any order and more than once, they are sorted out by Build */
+	void Add(const int32 DocId, const FString& Token);
+
+	void Build();
+
+	/* Sets the bit of every document that has a token starting with the lowercase prefix */
+	void FindPrefix(FStringView Prefix, TBitArray<>& out_Docs) const;
+
+	/*
+	 * Finds the documents where every whitespace separated word of the query
+	 * is the start of a token, fills one page of them in document order and returns the
+	 * number of matches over all pages. NumDocs has to be past every added document id,
+	 * and an empty query matches all of them.
+	 */
+	int32 Search(const FString& Query, const int32 NumDocs, const int32 PageIndex, const int32 PageSize, TArray<int32>& out_DocIds) const;
+
+	/* Path segments, plus the words in them split at separators, case changes and digits */
+	static void Tokenize(FStringView Text, TArray<FString>& out_Tokens);
+
+	int32 NumTokens() const
+	{
+		return FMath::Max(PostingStarts.Num() - 1, 0);
+	}
+
+	SIZE_T GetAllocatedSize() const;
+private:
+	struct FNode
+	{
+		int32 FirstChild = INDEX_NONE;
+		int32 LastChild = INDEX_NONE;
+		int32 NextSibling = INDEX_NONE;
+		/* Range of sorted tokens in this subtree */
+		int32 TokenBegin = 0;
+		int32 TokenEnd = 0;
+		TCHAR Char = 0;
+	};
+
+	TArray<TPair<FString, int32>> Pending;
+	TArray<FNode> Nodes;
+	/* Postings of token N are Postings[PostingStarts[N]] up to Postings[PostingStarts[N + 1]] */
+	TArray<int32> PostingStarts;
+	TArray<int32> Postings;
+};
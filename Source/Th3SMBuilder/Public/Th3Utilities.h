@@ -244,6 +244,12 @@ namespace Th3Utilities
 		return RetVal;
 	}
 
+	/*
+	 * Checks whether a string contains a lowercase word, ignoring ASCII case.
+	 * Candidate positions are found 8 characters at a time where SSE2 is available.
+	 */
+	bool ContainsLowerAscii(FStringView Haystack, FStringView LowerNeedle);
+
 	UClass* GenerateNewClass(const FString& Package, const FString& Name, UClass* ParentClass);
 	void DumpObjectProperties(const UObject* Obj, const FString& Indent, FString& Data);
 	void SaveObjectProperties(const UObject* Obj, const FString& FolderName, FString& Data);
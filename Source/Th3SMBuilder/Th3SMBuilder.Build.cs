@@ -16,7 +16,7 @@ public class Th3SMBuilder : ModuleRules
         PublicDependencyModuleNames.AddRange(new string[] {
             "Core", "CoreUObject", "Engine",
             "DeveloperSettings", "PhysicsCore", "InputCore",
-            "AssetRegistry", "RenderCore", "RHI",
+            "AssetRegistry", "RenderCore", "RHI", "Projects",
             "SlateCore", "Slate", "UMG", "GameplayTags",
             "DummyHeaders", "FactoryGame", "SML",
         });